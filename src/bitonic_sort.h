@@ -27,7 +27,8 @@
     BITONIC_SORT_SHUFD(pair, shufd_imm); \
     BITONIC_SORT_MINMAX(pair)
 
-static ymm_pair_t bitonic_sort4x16x8_inner(ymm_pair_t pair) {
+// always inlined, as the callers need the pair kept in registers
+static inline __attribute__((always_inline)) ymm_pair_t bitonic_sort4x16x8_inner(ymm_pair_t pair) {
     // zip together
     pair = (ymm_pair_t) {_mm256_unpackhi_epi8(pair.ymm1, pair.ymm0),
         _mm256_unpacklo_epi8(pair.ymm1, pair.ymm0)};
@@ -70,6 +71,79 @@ static ymm_pair_t bitonic_sort4x16x8_inner(ymm_pair_t pair) {
     return (ymm_pair_t) {shifted, masked};
 }
 
+#ifdef USE_AVX512
+// the same network over 4 lanes, see bitonic_sort8x16x8_inner
+#define BITONIC_SORT512_BLENDD(pair, imm) \
+    pair = (zmm_pair_t) {_mm512_mask_blend_epi32(BROADCAST_4x(4, imm), pair.zmm0, pair.zmm1), \
+    _mm512_mask_blend_epi32(BROADCAST_4x(4, imm), pair.zmm1, pair.zmm0)}
+
+#define BITONIC_SORT512_BLENDW(pair) \
+    pair = (zmm_pair_t) {_mm512_mask_blend_epi16(0xaaaaaaaa, pair.zmm0, pair.zmm1), \
+        _mm512_mask_blend_epi16(0xaaaaaaaa, pair.zmm1, pair.zmm0)}
+
+#define BITONIC_SORT512_SHUFD(pair, imm) \
+    pair.zmm1 = _mm512_shuffle_epi32(pair.zmm1, (_MM_PERM_ENUM) imm)
+
+#define BITONIC_SORT512_SHUFB(pair, indices) \
+    pair.zmm1 = _mm512_shuffle_epi8(pair.zmm1, QUAD_XMM(indices))
+
+#define BITONIC_SORT512_MINMAX(pair) \
+    pair = (zmm_pair_t) {_mm512_min_epu8(pair.zmm0, pair.zmm1), \
+        _mm512_max_epu8(pair.zmm1, pair.zmm0)}
+
+#define BITONIC_SORT512_STEP(pair, blend_imm, shufd_imm) \
+    BITONIC_SORT512_BLENDD(pair, blend_imm); \
+    BITONIC_SORT512_SHUFD(pair, shufd_imm); \
+    BITONIC_SORT512_MINMAX(pair)
+
+/* bitonic_sort4x16x8_inner for 8 arrays, one per 128 bit lane of the pair.
+ * every step of it stays within a lane, so it's the same steps as is
+ */
+static inline __attribute__((always_inline)) zmm_pair_t bitonic_sort8x16x8_inner(zmm_pair_t pair) {
+    // zip together
+    pair = (zmm_pair_t) {_mm512_unpackhi_epi8(pair.zmm1, pair.zmm0),
+        _mm512_unpacklo_epi8(pair.zmm1, pair.zmm0)};
+
+    // 2
+    BITONIC_SORT512_MINMAX(pair);
+
+    // 4
+    BITONIC_SORT512_SHUFD(pair, SHUFD_REV_2x32_256);
+    BITONIC_SORT512_MINMAX(pair);
+
+    BITONIC_SORT512_STEP(pair, 0b1010, SHUFD_REV_2x32_256);
+
+    // 8
+    BITONIC_SORT512_SHUFD(pair, SHUFD_REV_4x32_256);
+    BITONIC_SORT512_MINMAX(pair);
+
+    BITONIC_SORT512_STEP(pair, 0b1010, SHUFD_REV_2x32_256);
+    BITONIC_SORT512_STEP(pair, 0b1100, SHUFD_REV_2x64_256);
+
+    // 16
+    BITONIC_SORT512_SHUFB(pair, SHUFB_REV_8x16_128);
+    BITONIC_SORT512_MINMAX(pair);
+    BITONIC_SORT512_BLENDW(pair);
+    BITONIC_SORT512_SHUFB(pair, SHUFB_REV_4x16_128);
+
+    BITONIC_SORT512_STEP(pair, 0b1010, SHUFD_REV_2x32_256);
+    BITONIC_SORT512_STEP(pair, 0b1100, SHUFD_REV_2x64_256);
+    BITONIC_SORT512_STEP(pair, 0b1010, SHUFD_REV_2x32_256);
+
+    // pack back together
+    // interlace words
+    BITONIC_SORT512_SHUFB(pair, SHUFB_REV_2x16_128);
+    BITONIC_SORT512_BLENDW(pair);
+    BITONIC_SORT512_SHUFB(pair, SHUFB_REV_2x16_128);
+
+    // interlace bytes
+    const __m512i low_bytes = _mm512_set1_epi16(0xff);
+    __m512i shifted = _mm512_packus_epi16(_mm512_srli_epi16(pair.zmm0, 8), _mm512_srli_epi16(pair.zmm1, 8));
+    __m512i masked = _mm512_packus_epi16(_mm512_and_si512(pair.zmm0, low_bytes), _mm512_and_si512(pair.zmm1, low_bytes));
+    return (zmm_pair_t) {shifted, masked};
+}
+#endif
+
 extern void bitonic_sort4x16x8(uint8_t* arrays);
 
 #endif
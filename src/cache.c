@@ -0,0 +1,80 @@
+#include "cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct cache main_cache = {0};
+
+void cache_init(struct cache* cache, int shard_count) {
+    if (shard_count < 1) shard_count = 1;
+    if (cache->shard_count < shard_count) {
+        struct cache_stats* stats = aligned_alloc(64, shard_count * sizeof(struct cache_stats));
+        memset(stats, 0, shard_count * sizeof(struct cache_stats));
+        if (cache->stats) memcpy(stats, cache->stats, cache->shard_count * sizeof(struct cache_stats));
+        free(cache->stats);
+        cache->stats = stats;
+        cache->shard_count = shard_count;
+    }
+
+    if (cache->buckets) return;
+    int bucket_log = cache->size_log - 6;
+    if (bucket_log < CACHE_MIN_INDEX_BITS) bucket_log = CACHE_MIN_INDEX_BITS;
+    cache->buckets = aligned_alloc(64, sizeof(struct cache_bucket) << bucket_log);
+    memset(cache->buckets, 0, sizeof(struct cache_bucket) << bucket_log);
+    cache->global_trial = 0;
+    cache->mask = ((uint64_t) 1 << bucket_log) - 1;
+    cache->index_bits = bucket_log;
+    // trial 0 should always mean blank
+    invalidate_cache(cache);
+}
+
+struct cache_stats* cache_stats_shard(struct cache* cache, int shard) {
+    return cache->stats + shard;
+}
+
+static void next_trial(struct cache* cache) {
+    // the trial only gets 8 bits in each entry
+    cache->global_trial = (cache->global_trial + 1) & (CACHE_TRIAL_MASK >> CACHE_TRIAL_SHIFT);
+    // clear the cache if we hit overflow
+    if (!cache->global_trial) {
+        for (uint64_t i = 0; i <= cache->mask; i++)
+            for (int j = 0; j < CACHE_WAYS; j++)
+                atomic_store_explicit(cache->buckets[i].ways + j, 0, memory_order_relaxed);
+        cache->global_trial++;
+    }
+}
+
+void invalidate_cache(struct cache* cache) {
+    cache->carry_limit = 0;
+    next_trial(cache);
+}
+
+void cache_carry_over(struct cache* cache, int limit) {
+    cache->carry_limit = limit;
+    next_trial(cache);
+}
+
+void cache_free(struct cache* cache) {
+    free(cache->buckets);
+    free(cache->stats);
+    cache->buckets = NULL;
+    cache->stats = NULL;
+    cache->shard_count = 0;
+}
+
+void cache_print_stats(struct cache* cache) {
+    struct cache_stats total = {0};
+    for (int i = 0; i < cache->shard_count; i++) {
+        total.total_checks += cache->stats[i].total_checks;
+        total.same_depth_hits += cache->stats[i].same_depth_hits;
+        total.dif_layer_hits += cache->stats[i].dif_layer_hits;
+        total.misses += cache->stats[i].misses;
+        total.bucket_util += cache->stats[i].bucket_util;
+    }
+    printf("cache checks: %'ld; same depth hits: %'ld; dif layer hits: %'ld; misses: %'ld; bucket utilization: %'ld\n",
+            total.total_checks,
+            total.same_depth_hits,
+            total.dif_layer_hits,
+            total.misses,
+            total.bucket_util);
+}
@@ -1,79 +1,179 @@
 #ifndef CACHE_H
 #define CACHE_H
 #include <immintrin.h>
+#include <stdatomic.h>
 #include <stdint.h>
 
-struct cache_entry {
-    uint64_t value;
-    uint32_t trial;
-    uint8_t depth;
-};
+/* shared transposition table
+ *
+ * every entry is a fact proven by the search: the value has no solution
+ * within some number of remaining layers. since that doesn't depend on where
+ * in the search the value came up, entries stay valid across iterative
+ * deepening, and only go stale when the rules of the search change.
+ *
+ * the table is split into buckets of one cache line each, so every probe
+ * costs at most one miss. each bucket holds CACHE_WAYS entries, and each
+ * entry is packed into a single 64 bit word:
+ *   63..13: fingerprint, every bit of the hash above the bucket index
+ *   12..5:  trial, 0 means blank
+ *   4..0:   remaining layers proven to have no solution, at most 31
+ * there are always at least 2^13 buckets, so the fingerprint has room for all
+ * of the hash the bucket index doesn't cover. the hash is a bijection, so a
+ * matching entry is always for the same value, never just a collision.
+ *
+ * any number of threads can probe and insert at the same time without locks,
+ * as every entry is read and written with a single atomic access. two threads
+ * racing to fill the same bucket can only lose one of the entries.
+ */
+#define CACHE_WAYS 8
+#define CACHE_REMAINING_MASK ((uint64_t) 0x1f)
+#define CACHE_TRIAL_SHIFT 5
+#define CACHE_TRIAL_MASK ((uint64_t) 0xff << CACHE_TRIAL_SHIFT)
+#define CACHE_FINGERPRINT_SHIFT 13
+#define CACHE_FINGERPRINT_MASK (~(uint64_t) 0 << CACHE_FINGERPRINT_SHIFT)
+// the fingerprint only has 64 - CACHE_FINGERPRINT_SHIFT bits, so it takes at
+// least this many bits of bucket index to cover the rest of the hash
+#define CACHE_MIN_INDEX_BITS CACHE_FINGERPRINT_SHIFT
+
+struct cache_bucket {
+    _Atomic uint64_t ways[CACHE_WAYS];
+} __attribute__((aligned(64)));
+
+// one set of counters per thread, so the hot path never shares a line
+struct cache_stats {
+    long total_checks, same_depth_hits, dif_layer_hits, misses, bucket_util;
+} __attribute__((aligned(64)));
 
 struct cache {
-    struct cache_entry* array;
+    struct cache_bucket* buckets;
     uint64_t mask;
+    // log2 of the bucket count, which is where the fingerprint starts
+    int index_bits;
     uint32_t global_trial;
+    // entries from the trial before this one prove at most this many layers
+    int carry_limit;
+    // log2 of the table size in bytes
     int size_log;
-    struct cache_stats {
-        long total_checks, same_depth_hits, dif_layer_hits, misses, bucket_util;
-    } stats;
+    int shard_count;
+    struct cache_stats* stats;
 };
 
-static struct cache main_cache = {0};
+extern struct cache main_cache;
 
-static int cache_check(struct cache* cache, uint64_t value, int depth) {
-    uint32_t pos = _mm_crc32_u32(_mm_crc32_u32(0, value & UINT32_MAX), value >> 32) & cache->mask;
-    struct cache_entry* entry = cache->array + pos;
-    cache->stats.total_checks++;
-    if (entry->value == value && entry->depth <= depth && entry->trial == cache->global_trial) {
-        if (entry->depth == depth) cache->stats.same_depth_hits++;
-        else cache->stats.dif_layer_hits++;
-        return 1;
-    }
+// murmur3's finalizer, which is a bijection on 64 bits
+static inline uint64_t cache_hash(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccd;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53;
+    value ^= value >> 33;
+    return value;
+}
 
-    if (entry->trial == cache->global_trial && entry->value != value) cache->stats.misses++;
-    else cache->stats.bucket_util++;
+// how many remaining layers an entry still proves, -1 if it's stale
+static inline int cache_way_remaining(struct cache* cache, uint64_t way) {
+    uint32_t trial = (way & CACHE_TRIAL_MASK) >> CACHE_TRIAL_SHIFT;
+    int remaining = way & CACHE_REMAINING_MASK;
+    if (trial == cache->global_trial) return remaining;
+    if (trial && trial + 1 == cache->global_trial)
+        return remaining < cache->carry_limit ? remaining : cache->carry_limit;
+    return -1;
+}
+
+// the part of the hash an entry keeps, see the layout above
+static inline uint64_t cache_fingerprint(struct cache* cache, uint64_t hash) {
+    return (hash >> cache->index_bits) << CACHE_FINGERPRINT_SHIFT;
+}
+
+// pull in the bucket for a hash ahead of checking it
+static inline void cache_prefetch(struct cache* cache, uint64_t hash) {
+    _mm_prefetch((const char*) (cache->buckets + (hash & cache->mask)), _MM_HINT_T0);
+}
 
-    entry->value = value;
-    entry->depth = depth;
-    entry->trial = cache->global_trial;
+/* returns 1 if the value behind the hash is already known to have no
+ * solution within the given number of remaining layers
+ */
+static inline int cache_check_hashed(struct cache* cache, struct cache_stats* stats, uint64_t hash, int remaining) {
+    struct cache_bucket* bucket = cache->buckets + (hash & cache->mask);
+    uint64_t fingerprint = cache_fingerprint(cache, hash);
+    stats->total_checks++;
 
+    for (int i = 0; i < CACHE_WAYS; i++) {
+        uint64_t way = atomic_load_explicit(bucket->ways + i, memory_order_relaxed);
+        if ((way & CACHE_FINGERPRINT_MASK) != fingerprint) continue;
+        int proven = cache_way_remaining(cache, way);
+        if (proven < remaining) continue;
+        if (proven == remaining) stats->same_depth_hits++;
+        else stats->dif_layer_hits++;
+        return 1;
+    }
     return 0;
 }
 
-static void invalidate_cache(struct cache* cache) {
-    cache->global_trial++;
-    // clear the cache if we somehow hit overflow
-    if (!cache->global_trial) {
-        for (int i = 0; i <= cache->mask; i++) {
-            cache->array[i].value = 0;
-            cache->array[i].depth = 0;
-            cache->array[i].trial = 0;
+/* record that the value behind the hash has no solution within the given
+ * number of remaining layers. only call this once the search under it has run
+ * to completion, anything cut short proves nothing
+ */
+static inline void cache_store_hashed(struct cache* cache, struct cache_stats* stats, uint64_t hash, int remaining) {
+    struct cache_bucket* bucket = cache->buckets + (hash & cache->mask);
+    uint64_t fingerprint = cache_fingerprint(cache, hash);
+    // proving fewer layers than were searched is still true
+    if (remaining > (int) CACHE_REMAINING_MASK) remaining = CACHE_REMAINING_MASK;
+
+    // stale entries get evicted first, then the ones proving the fewest
+    // layers since they took the least work to find
+    int victim = 0;
+    int victim_remaining = CACHE_REMAINING_MASK + 1;
+    for (int i = 0; i < CACHE_WAYS; i++) {
+        uint64_t way = atomic_load_explicit(bucket->ways + i, memory_order_relaxed);
+        int proven = cache_way_remaining(cache, way);
+        if ((way & CACHE_FINGERPRINT_MASK) == fingerprint && proven >= 0) {
+            // someone else already proved at least as much
+            if (proven >= remaining) return;
+            victim = i;
+            victim_remaining = -1;
+            break;
         }
-        // trial 0 should always mean blank
-        cache->global_trial++;
+        if (proven >= victim_remaining) continue;
+        victim = i;
+        victim_remaining = proven;
     }
-}
 
-static void cache_init(struct cache* cache) {
-    if (cache->array) return;
-    cache->array = calloc((1 << cache->size_log), sizeof(struct cache_entry));
-    cache->global_trial = 0;
-    cache->mask = (1 << cache->size_log) - 1;
+    if (victim_remaining >= 0) stats->misses++;
+    else stats->bucket_util++;
+
+    uint64_t trial = (uint64_t) cache->global_trial << CACHE_TRIAL_SHIFT;
+    atomic_store_explicit(bucket->ways + victim, fingerprint | trial | remaining, memory_order_relaxed);
 }
 
-static void cache_free(struct cache* cache) {
-    if (!cache->array) return;
-    free(cache->array);
+static inline int cache_check(struct cache* cache, struct cache_stats* stats, uint64_t value, int remaining) {
+    return cache_check_hashed(cache, stats, cache_hash(value), remaining);
 }
 
-static void cache_print_stats(struct cache* cache) {
-    printf("cache checks: %'ld; same depth hits: %'ld; dif layer hits: %'ld; misses: %'ld; bucket utilization: %'ld\n",
-            cache->stats.total_checks,
-            cache->stats.same_depth_hits,
-            cache->stats.dif_layer_hits,
-            cache->stats.misses,
-            cache->stats.bucket_util);
+static inline void cache_store(struct cache* cache, struct cache_stats* stats, uint64_t value, int remaining) {
+    cache_store_hashed(cache, stats, cache_hash(value), remaining);
 }
 
+/* allocate the table if it isn't already, with at least shard_count sets of
+ * stats. the size is fixed by size_log on the first call, and never goes
+ * below 2^CACHE_MIN_INDEX_BITS buckets
+ */
+void cache_init(struct cache* cache, int shard_count);
+
+struct cache_stats* cache_stats_shard(struct cache* cache, int shard);
+
+// mark every entry as stale, only call while no searches are running
+void invalidate_cache(struct cache* cache);
+
+/* start a new trial where everything proven so far only counts for up to
+ * limit remaining layers, for when the search gets less strict about pruning.
+ * only call while no searches are running
+ */
+void cache_carry_over(struct cache* cache, int limit);
+
+void cache_free(struct cache* cache);
+
+// print the stats summed over all shards
+void cache_print_stats(struct cache* cache);
+
 #endif
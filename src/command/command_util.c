@@ -0,0 +1,20 @@
+#include "command_util.h"
+#include <stdlib.h>
+#include <string.h>
+
+char** append_str(char** str1, char* str2) {
+    if (!str2) return str1;
+
+    if (*str1) {
+        char* new_str = malloc(strlen(*str1) + strlen(str2) + 1);
+        strcpy(new_str, *str1);
+        strcat(new_str, str2);
+        free(*str1);
+        *str1 = new_str;
+    } else {
+        *str1 = malloc(strlen(str2) + 1);
+        strcpy(*str1, str2);
+    }
+
+    return str1;
+}
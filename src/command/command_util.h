@@ -0,0 +1,7 @@
+#ifndef COMMAND_UTIL_H
+#define COMMAND_UTIL_H
+
+// appends str2 to the malloced string in *str1, or copies it there if *str1 is NULL
+char** append_str(char** str1, char* str2);
+
+#endif
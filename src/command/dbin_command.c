@@ -1,24 +1,9 @@
 #include "dbin_command.h"
+#include "command_util.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-char** append_str(char** str1, char* str2) { 
-    if (!str2) return str1;
-
-    if (*str1) {
-        char* new_str = malloc(strlen(*str1) + strlen(str2) + 1);
-        strcpy(new_str, *str1);
-        if (str2) strcat(new_str, str2);
-        free(*str1);
-        *str1 = new_str;
-    } else {
-        *str1 = malloc(strlen(str2) + 1);
-        strcpy(*str1, str2);
-    }
-
-    return str1;
-}
 enum LONG_OPTIONS {
     LONG_OPTION_MAX_DEPTH = 1000,
     LONG_OPTION_ACCURACY,
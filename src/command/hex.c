@@ -1,24 +1,9 @@
 #include "hex.h"
+#include "command_util.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static char** append_str(char** str1, char* str2) { 
-    if (!str2) return str1;
-
-    if (*str1) {
-        char* new_str = malloc(strlen(*str1) + strlen(str2) + 1);
-        strcpy(new_str, *str1);
-        if (str2) strcat(new_str, str2);
-        free(*str1);
-        *str1 = new_str;
-    } else {
-        *str1 = malloc(strlen(str2) + 1);
-        strcpy(*str1, str2);
-    }
-
-    return str1;
-}
 enum LONG_OPTIONS {
     LONG_OPTION_MAX_DEPTH = 1000,
     LONG_OPTION_ACCURACY,
@@ -30,22 +15,34 @@ static const char doc[] =
 ;
 
 static const struct argp_option options[] = {
+    { "multi", 'm', 0, 0, "Treat every argument as its own function, solving all of them in one search" },
     { 0 }
 };
 
 static error_t parse_opt(int key, char* arg, struct argp_state *state) {
     struct arg_settings_command_hex* settings = state->input;
     switch (key) {
+        case 'm':
+            settings->multi = 1;
+            break;
         case ARGP_KEY_ARG:
             append_str(&(settings->map), arg);
+            settings->maps = realloc(settings->maps, (settings->map_count + 1) * sizeof(char*));
+            settings->maps[settings->map_count++] = arg;
             break;
         case ARGP_KEY_INIT:
             settings->map = 0;
+            settings->maps = NULL;
+            settings->map_count = 0;
+            settings->multi = 0;
             settings->settings_solver_hex.global = settings->global;
             state->child_inputs[0] = &settings->settings_solver_hex;
             break;
         case ARGP_KEY_SUCCESS:
-            hlp_print_search(settings->map);
+            if (settings->multi)
+                hlp_print_multi_search(settings->maps, settings->map_count);
+            else
+                hlp_print_search(settings->map);
             break;
         case ARGP_KEY_NO_ARGS:
             argp_state_help(state, stderr, ARGP_HELP_USAGE | ARGP_HELP_SHORT_USAGE | ARGP_HELP_SEE);
@@ -6,6 +6,10 @@
 struct arg_settings_command_hex {
     struct arg_settings_global* global;
     char* map;
+    // every argument on its own, for --multi
+    char** maps;
+    int map_count;
+    int multi;
     struct arg_settings_solver_hex settings_solver_hex;
 };
 
@@ -0,0 +1,91 @@
+#include "optimize.h"
+#include "command_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../redstone.h"
+#include "../vector_tools.h"
+#include "../solver/hlp_finish.h"
+#include "../solver/hlp_optimize.h"
+
+enum LONG_OPTIONS {
+    LONG_OPTION_WINDOW = 1000,
+    LONG_OPTION_FINISH_LAYERS,
+    LONG_OPTION_FINISH_DIR
+};
+
+static const char doc[] =
+"Shorten a hex layer chain by swapping out short stretches of it for shorter ones that do the same thing"
+;
+
+static const struct argp_option options[] = {
+    { "window", LONG_OPTION_WINDOW, "N", 0, "Try to replace up to N layers at a time. default: 6" },
+    { "finish-layers", LONG_OPTION_FINISH_LAYERS, "N", 0, "Replace them with up to N layers from the finish index, up to 3. default: 2" },
+    { "finish-dir", LONG_OPTION_FINISH_DIR, "DIR", 0, "Keep finish indexes as files in DIR, so they only get built once" },
+    { 0 }
+};
+
+static void print_optimized(struct arg_settings_command_optimize* settings) {
+    uint16_t chain[HLP_OPTIMIZE_MAX_LENGTH];
+    int length = parse_chain(settings->chain, chain, HLP_OPTIMIZE_MAX_LENGTH);
+    if (length < 0) {
+        printf("Error: malformed chain\n");
+        return;
+    }
+
+    // nothing shorter can bring the map down to fewer values than it ends up with
+    uint64_t map = apply_hex_chain(IDENTITY_PERM_PK64, chain, length);
+    const struct hlp_finish_index* index = hlp_finish_index_get(get_group64(map), settings->finish_layers, settings->finish_dir);
+    if (!index) {
+        printf("an error occurred\n");
+        return;
+    }
+
+    int optimized_length = hlp_optimize_chain(chain, length, settings->max_window, index);
+    if (settings->global->verbosity > 0)
+        printf("optimized %d layers down to %d:  ", length, optimized_length);
+    print_chain(chain, optimized_length);
+    printf("\n");
+}
+
+static error_t parse_opt(int key, char* arg, struct argp_state *state) {
+    struct arg_settings_command_optimize* settings = state->input;
+    switch (key) {
+        case LONG_OPTION_WINDOW:
+            settings->max_window = atoi(arg);
+            if (settings->max_window < 1)
+                argp_error(state, "%s is not a valid window", arg);
+            break;
+        case LONG_OPTION_FINISH_LAYERS:
+            settings->finish_layers = atoi(arg);
+            if (settings->finish_layers < 1 || settings->finish_layers > HLP_FINISH_MAX_LAYERS)
+                argp_error(state, "%s is not a valid number of finish layers", arg);
+            break;
+        case LONG_OPTION_FINISH_DIR:
+            settings->finish_dir = arg;
+            break;
+        case ARGP_KEY_ARG:
+            append_str(&(settings->chain), arg);
+            break;
+        case ARGP_KEY_INIT:
+            settings->chain = 0;
+            settings->max_window = 6;
+            settings->finish_layers = 2;
+            settings->finish_dir = NULL;
+            break;
+        case ARGP_KEY_SUCCESS:
+            print_optimized(settings);
+            break;
+        case ARGP_KEY_NO_ARGS:
+            argp_state_help(state, stderr, ARGP_HELP_USAGE | ARGP_HELP_SHORT_USAGE | ARGP_HELP_SEE);
+            return 1;
+    }
+    return 0;
+}
+
+struct argp argp_command_optimize = {
+    options,
+    parse_opt,
+    "CHAIN",
+    doc
+};
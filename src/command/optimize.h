@@ -0,0 +1,15 @@
+#ifndef COMMAND_OPTIMIZE_H
+#define COMMAND_OPTIMIZE_H
+#include "../arg_global.h"
+
+struct arg_settings_command_optimize {
+    struct arg_settings_global* global;
+    char* chain;
+    int max_window;
+    int finish_layers;
+    char* finish_dir;
+};
+
+extern struct argp argp_command_optimize;
+
+#endif
@@ -10,12 +10,14 @@
 #include "solver/hlp_solve.h"
 #include "command/hex.h"
 #include "command/dbin_command.h"
+#include "command/optimize.h"
 #include "search/hlp_random.h"
 #include "search/dbin_random.h"
 
 union arg_settings_sub {
     struct arg_settings_solver_hex solver_hex;
     struct arg_settings_command_hex command_hex;
+    struct arg_settings_command_optimize command_optimize;
     struct arg_settings_search_hlp_random search_hlp_random;
     struct arg_settings_search_dbin_random search_dbin_random;
 };
@@ -56,6 +58,7 @@ error_t process_subcommand(const char* name, struct argp_state* state, struct ar
 const struct subcommand_entry subcommand_entries[] = {
     { "hex", &argp_command_hex, offsetof(struct arg_settings_command_hex, global) },
     { "hlp", &argp_command_hex, offsetof(struct arg_settings_command_hex, global) },
+    { "optimize", &argp_command_optimize, offsetof(struct arg_settings_command_optimize, global) },
     { "2bin", &argp_command_dbin, offsetof(struct arg_settings_command_dbin, global) },
     { "search-hlp-random", &argp_search_hlp_random, offsetof(struct arg_settings_search_hlp_random, global) },
     { "search-2bin-random", &argp_search_dbin_random, offsetof(struct arg_settings_search_dbin_random, global) },
@@ -66,6 +69,7 @@ static const char doc_global[] =
 "\v"
 "Supported subcommands:\n"
 "  hex, hlp     Find a solution for the vanilla hex layer problem\n"
+"  optimize     Shorten a hex layer chain\n"
 "  2bin         Find a solution for the dual binary problem\n"
 "  search-*     Automated searchers\n"
 "  search       List available searchers\n"
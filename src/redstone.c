@@ -4,6 +4,8 @@
 #include "stdio.h"
 #include "time.h"
 #include "stdlib.h"
+#include "string.h"
+#include "ctype.h"
 
 
 static int verbosity = 0;
@@ -53,7 +55,12 @@ int round_up(int n, int factor) {
 }
 
 #define LAYER_COUNT_ESTIMATE 1024
+// the avx512 kernels read the maps 8 at a time instead of 4
+#ifdef USE_AVX512
+#define MAP_ARRAY_ALIGNMENT 8
+#else
 #define MAP_ARRAY_ALIGNMENT 4
+#endif
 
 //precompute of layers into lut, proceding layers deduplicated for lower branching
 struct precomputed_hex_layer* precompute_hex_layers(int group, int direction) {
@@ -128,6 +135,10 @@ struct precomputed_hex_layer* precompute_hex_layers(int group, int direction) {
                 apply_mapping_packed64(first_layer->map, second_layer->map);
             if (get_group64(output) < group) continue;
 
+            // the tree is shared by every first layer, so of all the pairs
+            // that give the same map only the first one is kept. that covers
+            // both orders of two layers that commute, so the search never
+            // sees a chain and the same one with two neighbours swapped
             if (aa_find(unique_next_layers_tree, &output)) continue;
             tree_data[next_layer_count] = output;
             aa_add(unique_next_layers_tree, tree_data + next_layer_count, NULL);
@@ -147,16 +158,21 @@ struct precomputed_hex_layer* precompute_hex_layers(int group, int direction) {
     // both of these will just be one big block containing multiple arrays
     struct precomputed_hex_layer** next_layer_array = malloc(next_layer_count * sizeof(struct precomputed_hex_layer*));
     uint64_t* next_map_array = calloc(map_spaces_needed, sizeof(uint64_t));
+    uint64_t* pair_map_array = calloc(map_spaces_needed, sizeof(uint64_t));
 
     for (int layer_index = 0; layer_index < layer_count + 1; layer_index++) {
         struct precomputed_hex_layer* layer = layers + layer_index;
         layer->next_layers = next_layer_array + next_layer_starts[layer_index];
         layer->next_layer_luts = next_map_array + next_map_starts[layer_index];
+        layer->pair_luts = pair_map_array + next_map_starts[layer_index];
 
         // fill in the arrays
         for (int next_layer_index = 0; next_layer_index < layer->next_layer_count; next_layer_index++) {
             layer->next_layers[next_layer_index] = layers + next_layer_indices[next_layer_starts[layer_index] + next_layer_index];
             layer->next_layer_luts[next_layer_index] = layer->next_layers[next_layer_index]->map;
+            layer->pair_luts[next_layer_index] = direction < 0 ?
+                apply_mapping_packed64(layer->next_layer_luts[next_layer_index], layer->map) :
+                apply_mapping_packed64(layer->map, layer->next_layer_luts[next_layer_index]);
         }
     }
     free(next_layer_indices);
@@ -176,6 +192,7 @@ void free_precomputed_hex_layers() {
         if (precomputed_hex_layer_history[i]) {
             free(precomputed_hex_layer_history[i]->next_layers);
             free(precomputed_hex_layer_history[i]->next_layer_luts);
+            free(precomputed_hex_layer_history[i]->pair_luts);
             free(precomputed_hex_layer_history[i]);
         }
     }
@@ -239,6 +256,42 @@ void print_chain(uint16_t* chain, int length) {
     }
 }
 
+int parse_chain(const char* str, uint16_t* chain, int max_length) {
+    // the marks before each barrel value, in the same order as print_chain
+    const char mode_marks[][2][3] = {
+        { "", "" },
+        { "", "*" },
+        { "*", "" },
+        { "*", "*" },
+        { "^", "*" },
+        { "^*", "" }
+    };
+    int length = 0;
+    while (*str) {
+        char marks[2][3] = { "", "" };
+        int values[2];
+        for (int side = 0; side < 2; side++) {
+            while (*str == ' ') str++;
+            for (int i = 0; i < 2 && (*str == '^' || *str == '*'); i++)
+                marks[side][i] = *str++;
+            if (!isxdigit(*str)) return -1;
+            values[side] = isdigit(*str) ? *str - '0' : toupper(*str) - 'A' + 10;
+            str++;
+            while (*str == ' ') str++;
+            if (side == 0 && *str++ != ',') return -1;
+        }
+        if (*str == ';') str++;
+        else if (*str) return -1;
+
+        int mode = 0;
+        while (mode < 6 && (strcmp(mode_marks[mode][0], marks[0]) || strcmp(mode_marks[mode][1], marks[1]))) mode++;
+        if (mode == 6 || length == max_length) return -1;
+        chain[length++] = (mode << 8) | (values[0] << 4) | values[1];
+        while (*str == ' ') str++;
+    }
+    return length;
+}
+
 
 
 enum LONG_OPTIONS {
@@ -9,6 +9,8 @@
 struct precomputed_hex_layer {
     uint64_t map;
     uint64_t* next_layer_luts;
+    // each next layer composed with this one, to take two steps at once
+    uint64_t* pair_luts;
     struct precomputed_hex_layer** next_layers;
     uint16_t config;
     uint16_t next_layer_count;
@@ -31,6 +33,11 @@ extern uint32_t dbin_layer_packed64(uint64_t map, uint16_t config);
 
 extern void print_chain(uint16_t* chain, int length);
 
+/* read a chain in the same format print_chain writes it
+ * returns its length, or -1 if it's malformed or longer than max_length
+ */
+extern int parse_chain(const char* str, uint16_t* chain, int max_length);
+
 
 /* get precomputed layers
  * 
@@ -34,6 +34,7 @@ struct dbin_solve_globals {
     struct __stats__ {
         uint64_t iterations, final_bsearches;
     } stats;
+    struct cache_stats* cache_stats;
 };
 
 // array of values if you look at the index in binary, and read it directly as a ternary number
@@ -100,6 +101,27 @@ uint64_t dbin_partial_unprepend_map_packed64(uint64_t map_uint, uint64_t state_u
     return _mm_cvtsi128_si64(result128);
 }
 
+#ifdef USE_AVX512
+/* dbin_partial_unprepend_map_packed64 for 8 maps at once, a qword each. the
+ * 4 16 bit parts of the state all get built up together, one input at a
+ * time, with vpmultishiftqb pulling out where each map sends that input
+ */
+static void dbin_partial_unprepend_map_packed64x8(const uint64_t* map_uints, uint64_t state_uint, uint64_t* results) {
+    __m512i maps = _mm512_loadu_si512(map_uints);
+    __m512i state = _mm512_set1_epi64(state_uint);
+    const __m512i state_mask = _mm512_set1_epi16(1);
+    const __m512i map_mask = _mm512_set1_epi16(15);
+
+    __m512i result = _mm512_setzero_si512();
+    for (int i = 0; i < 16; i++) {
+        __m512i values = _mm512_and_si512(_mm512_multishift_epi64_epi8(_mm512_set1_epi8(i < 8 ? 8 * i + 4 : 8 * (i - 8)), maps), map_mask);
+        __m512i bits = _mm512_and_si512(_mm512_srli_epi16(state, i), state_mask);
+        result = _mm512_or_si512(result, _mm512_sllv_epi16(bits, values));
+    }
+    _mm512_storeu_si512(results, result);
+}
+#endif
+
 int get_dbin_exact_group(uint32_t mask) {
     uint16_t first_bits = mask & UINT16_MAX;
     uint16_t second_bits = mask >> 16;
@@ -388,10 +410,18 @@ static int dfs(struct dbin_solve_globals* globals, struct precomputed_hex_layer*
         return 1;
     }
 
+#ifdef USE_AVX512
+    uint64_t next_remaining_maps[8];
+#endif
     for (int i = 0; i < layer->next_layer_count; i++) {
         globals->stats.iterations++;
         struct precomputed_hex_layer* next_layer = layer->next_layers[i];
+#ifdef USE_AVX512
+        if (i % 8 == 0) dbin_partial_unprepend_map_packed64x8(layer->next_layer_luts + i, remaining_map, next_remaining_maps);
+        uint64_t next_remaining_map = next_remaining_maps[i % 8];
+#else
         uint64_t next_remaining_map = dbin_partial_unprepend_map_packed64(next_layer->map, remaining_map);
+#endif
 
         // legality check
         if (next_remaining_map & (next_remaining_map >> 32)) continue;
@@ -401,7 +431,7 @@ static int dfs(struct dbin_solve_globals* globals, struct precomputed_hex_layer*
         if (uint4_array_get(globals->config.prune_table, get_ternary_index(next_remaining_map >> 16, next_remaining_map >> 48)) > remaining_depth) continue;
 
         // cache check
-        if (cache_check(&main_cache, next_remaining_map, 99 - remaining_depth)) continue;
+        if (cache_check(&main_cache, globals->cache_stats, next_remaining_map, remaining_depth - 1)) continue;
         // passed, check further
         
         int success = dfs(globals, next_layer, next_remaining_map, remaining_depth - 1);
@@ -411,6 +441,7 @@ static int dfs(struct dbin_solve_globals* globals, struct precomputed_hex_layer*
             if (verbosity > 3) printf("%03x (%016lx): %016lx\n", next_layer->config, little_endian_xmm_to_uint(unpack_uint_to_xmm(next_layer->map)), next_remaining_map);
             return 1;
         }
+        cache_store(&main_cache, globals->cache_stats, next_remaining_map, remaining_depth - 1);
     }
 
     return 0;
@@ -424,7 +455,9 @@ int dbin_solve(uint64_t partial_map, uint16_t* output_chain, int max_depth) {
     globals.config.group = get_dbin_exact_group(partial_map);
     globals.output.chain = output_chain;
     
-    cache_init(&main_cache);
+    cache_init(&main_cache, 1);
+    invalidate_cache(&main_cache);
+    globals.cache_stats = cache_stats_shard(&main_cache, 0);
 
     globals.config.unique_dbin_layers = precompute_dbin_layers(&globals.config.dbin_layers, globals.config.group);
 
@@ -441,7 +474,6 @@ int dbin_solve(uint64_t partial_map, uint16_t* output_chain, int max_depth) {
             }
             return depth + 1;
         }
-        invalidate_cache(&main_cache);
     }
     free(globals.config.prune_table);
     if (verbosity > 2) cache_print_stats(&main_cache);
@@ -506,7 +538,7 @@ enum LONG_OPTIONS {
 
 static const struct argp_option options[] = {
     { "max-layers", LONG_OPTION_MAX_DEPTH, "N", 0, "Limit results to chains up to N layers long, including the final 2bin layer" },
-    { "cache", LONG_OPTION_CACHE_SIZE, "N", 0, "Set the cache size to 2**N bytes. default: 26 (64MB)" },
+    { "cache", LONG_OPTION_CACHE_SIZE, "N", 0, "Set the cache size to 2**N bytes, at least 19 (512KB). default: 26 (64MB)" },
     { 0 }
 };
 
@@ -517,10 +549,10 @@ static error_t parse_opt(int key, char* arg, struct argp_state *state) {
             global_max_depth = atoi(arg);
             break;
         case LONG_OPTION_CACHE_SIZE:
-            main_cache.size_log = (atoi(arg) - 4);
+            main_cache.size_log = atoi(arg);
             break;
         case ARGP_KEY_INIT:
-            main_cache.size_log = 22;
+            main_cache.size_log = 26;
             break;
         case ARGP_KEY_SUCCESS:
             verbosity = settings->global->verbosity;
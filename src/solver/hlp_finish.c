@@ -0,0 +1,391 @@
+#include "hlp_finish.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../redstone.h"
+#include "../vector_tools.h"
+
+#define FINISH_FILE_MAGIC "HLPTFIN2"
+// each table is keyed by 4 outputs
+#define TABLE_BUCKETS (1 << 16)
+
+// what goes at the start of an index file, entries follow right after
+struct finish_file_header {
+    char magic[8];
+    int32_t group, layers;
+    int64_t counts[HLP_FINISH_MAX_CHAIN];
+} __attribute__((aligned(64)));
+
+struct finish_map_set {
+    uint64_t* slots;
+    uint64_t mask;
+    long count;
+    // 0 marks an empty slot, so it gets tracked on the side
+    int has_zero;
+};
+
+static struct hlp_finish_index* finish_index_history[16] = { 0 };
+static struct hlp_finish_index* goal_index = NULL;
+static uint16_t goal_index_values;
+
+static void map_set_init(struct finish_map_set* set, int size_log) {
+    set->slots = calloc((size_t) 1 << size_log, sizeof(uint64_t));
+    set->mask = ((uint64_t) 1 << size_log) - 1;
+    set->count = 0;
+    set->has_zero = 0;
+}
+
+static uint64_t map_set_slot(uint64_t map, uint64_t mask) {
+    // murmur3's finalizer
+    map ^= map >> 33;
+    map *= 0xff51afd7ed558ccd;
+    map ^= map >> 33;
+    return map & mask;
+}
+
+// returns 1 if the map was newly added
+static int map_set_add(struct finish_map_set* set, uint64_t map) {
+    if (!map) {
+        if (set->has_zero) return 0;
+        return set->has_zero = 1;
+    }
+
+    if (set->count * 2 > (long) set->mask) {
+        // grow once half full
+        struct finish_map_set bigger;
+        map_set_init(&bigger, __builtin_ctzll(set->mask + 1) + 1);
+        for (uint64_t i = 0; i <= set->mask; i++)
+            if (set->slots[i]) map_set_add(&bigger, set->slots[i]);
+        bigger.has_zero = set->has_zero;
+        free(set->slots);
+        *set = bigger;
+    }
+
+    for (uint64_t i = map_set_slot(map, set->mask);; i = (i + 1) & set->mask) {
+        if (set->slots[i] == map) return 0;
+        if (set->slots[i]) continue;
+        set->slots[i] = map;
+        set->count++;
+        return 1;
+    }
+}
+
+static int cmp_finish_entry(const void* a, const void* b) {
+    uint64_t map_a = ((struct hlp_finish_entry*) a)->map;
+    uint64_t map_b = ((struct hlp_finish_entry*) b)->map;
+    return (map_a > map_b) - (map_a < map_b);
+}
+
+// the outputs a table is keyed by, as a bucket
+static int table_bucket(uint64_t map, int table) {
+    return (map >> (48 - 16 * table)) & (TABLE_BUCKETS - 1);
+}
+
+// bucket every level's entries for each table, once the entries are in place
+static void build_tables(struct hlp_finish_index* index) {
+    for (int level = 0; level < index->layers; level++) {
+        const struct hlp_finish_entry* entries = index->entries[level];
+        long count = index->counts[level];
+        for (int table = 0; table < HLP_FINISH_TABLES; table++) {
+            // counting sort, leaving starts[bucket] at the end of each bucket
+            uint32_t* starts = calloc(TABLE_BUCKETS + 1, sizeof(uint32_t));
+            for (long i = 0; i < count; i++)
+                starts[table_bucket(entries[i].map, table) + 1]++;
+            for (int bucket = 0; bucket < TABLE_BUCKETS; bucket++)
+                starts[bucket + 1] += starts[bucket];
+            index->starts[level][table] = starts;
+            if (!table) continue;
+
+            uint32_t* ids = malloc(count * sizeof(uint32_t));
+            uint32_t* next = malloc(TABLE_BUCKETS * sizeof(uint32_t));
+            memcpy(next, starts, TABLE_BUCKETS * sizeof(uint32_t));
+            for (long i = 0; i < count; i++)
+                ids[next[table_bucket(entries[i].map, table)]++] = i;
+            free(next);
+            index->ids[level][table] = ids;
+        }
+    }
+}
+
+// every value the map gives as an output
+static uint16_t map_outputs(uint64_t map) {
+    uint16_t outputs = 0;
+    for (int i = 0; i < 16; i++, map >>= 4)
+        outputs |= 1 << (map & 15);
+    return outputs;
+}
+
+/* breadth first over every layer, keeping only maps not reached any sooner.
+ * with required_values, new layers go at the start of the chain instead of
+ * the end, so the outputs only ever shrink and dropping a map drops
+ * everything that would have been built on it
+ */
+static struct hlp_finish_index* build_index(int group, int layers, uint16_t required_values) {
+    struct precomputed_hex_layer* identity_layer = precompute_hex_layers(group, 1);
+    int layer_count = identity_layer->next_layer_count;
+
+    struct finish_map_set seen;
+    map_set_init(&seen, 16);
+    map_set_add(&seen, IDENTITY_PERM_PK64);
+
+    struct hlp_finish_entry* levels[HLP_FINISH_MAX_CHAIN];
+    long counts[HLP_FINISH_MAX_CHAIN];
+    long capacity = layer_count;
+    levels[0] = malloc(capacity * sizeof(struct hlp_finish_entry));
+    counts[0] = 0;
+    for (int i = 0; i < layer_count; i++) {
+        struct precomputed_hex_layer* layer = identity_layer->next_layers[i];
+        if ((map_outputs(layer->map) & required_values) != required_values) continue;
+        if (!map_set_add(&seen, layer->map)) continue;
+        levels[0][counts[0]++] = (struct hlp_finish_entry) { layer->map, { layer->config }, 1 };
+    }
+
+    for (int level = 1; level < layers; level++) {
+        capacity = counts[level - 1] * 4;
+        levels[level] = malloc(capacity * sizeof(struct hlp_finish_entry));
+        counts[level] = 0;
+        for (long i = 0; i < counts[level - 1]; i++) {
+            struct hlp_finish_entry* previous = levels[level - 1] + i;
+            for (int j = 0; j < layer_count; j++) {
+                struct precomputed_hex_layer* layer = identity_layer->next_layers[j];
+                uint64_t map = required_values ?
+                    apply_mapping_packed64(layer->map, previous->map) :
+                    apply_mapping_packed64(previous->map, layer->map);
+                if (get_group64(map) < group) continue;
+                if ((map_outputs(map) & required_values) != required_values) continue;
+                if (!map_set_add(&seen, map)) continue;
+
+                if (counts[level] == capacity) {
+                    capacity *= 2;
+                    levels[level] = realloc(levels[level], capacity * sizeof(struct hlp_finish_entry));
+                }
+                struct hlp_finish_entry* entry = levels[level] + counts[level]++;
+                *entry = *previous;
+                entry->map = map;
+                entry->length = level + 1;
+                if (required_values) {
+                    memcpy(entry->chain + 1, previous->chain, level * sizeof(uint16_t));
+                    entry->chain[0] = layer->config;
+                } else {
+                    entry->chain[level] = layer->config;
+                }
+            }
+        }
+    }
+    free(seen.slots);
+
+    // everything goes into one block so it has the same layout as the file
+    size_t storage_size = sizeof(struct finish_file_header);
+    for (int level = 0; level < layers; level++)
+        storage_size += counts[level] * sizeof(struct hlp_finish_entry);
+    char* storage = malloc(storage_size);
+    struct finish_file_header* header = (struct finish_file_header*) storage;
+    memset(header, 0, sizeof(struct finish_file_header));
+    memcpy(header->magic, FINISH_FILE_MAGIC, sizeof(header->magic));
+    header->group = group;
+    header->layers = layers;
+
+    struct hlp_finish_index* index = calloc(1, sizeof(struct hlp_finish_index));
+    index->group = group;
+    index->layers = layers;
+    index->storage = storage;
+    index->storage_size = storage_size;
+
+    char* position = storage + sizeof(struct finish_file_header);
+    for (int level = 0; level < layers; level++) {
+        for (long i = 0; i < counts[level]; i++)
+            levels[level][i].map = big_endian_xmm_to_uint(unpack_uint_to_xmm(levels[level][i].map));
+        qsort(levels[level], counts[level], sizeof(struct hlp_finish_entry), cmp_finish_entry);
+        memcpy(position, levels[level], counts[level] * sizeof(struct hlp_finish_entry));
+        free(levels[level]);
+        header->counts[level] = counts[level];
+        index->entries[level] = (struct hlp_finish_entry*) position;
+        index->counts[level] = counts[level];
+        position += counts[level] * sizeof(struct hlp_finish_entry);
+    }
+    build_tables(index);
+    return index;
+}
+
+static struct hlp_finish_index* map_index_file(const char* path, int group, int layers) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) || file_stat.st_size < (off_t) sizeof(struct finish_file_header)) {
+        close(fd);
+        return NULL;
+    }
+    void* storage = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (storage == MAP_FAILED) return NULL;
+
+    struct finish_file_header* header = storage;
+    size_t expected_size = sizeof(struct finish_file_header);
+    for (int level = 0; level < header->layers && level < HLP_FINISH_MAX_LAYERS; level++)
+        expected_size += header->counts[level] * sizeof(struct hlp_finish_entry);
+    if (memcmp(header->magic, FINISH_FILE_MAGIC, sizeof(header->magic)) ||
+            header->group != group ||
+            header->layers < layers ||
+            header->layers > HLP_FINISH_MAX_LAYERS ||
+            expected_size != (size_t) file_stat.st_size) {
+        munmap(storage, file_stat.st_size);
+        return NULL;
+    }
+
+    struct hlp_finish_index* index = calloc(1, sizeof(struct hlp_finish_index));
+    index->group = group;
+    index->layers = header->layers;
+    index->storage = storage;
+    index->storage_size = file_stat.st_size;
+    index->mapped = 1;
+    const struct hlp_finish_entry* position = (const struct hlp_finish_entry*) (header + 1);
+    for (int level = 0; level < index->layers; level++) {
+        index->entries[level] = position;
+        index->counts[level] = header->counts[level];
+        position += header->counts[level];
+    }
+    build_tables(index);
+    return index;
+}
+
+static void write_index_file(const char* path, struct hlp_finish_index* index) {
+    // write somewhere else first so nobody maps a half written file
+    char temp_path[4096];
+    if (snprintf(temp_path, sizeof(temp_path), "%s.%d.tmp", path, (int) getpid()) >= (int) sizeof(temp_path)) return;
+    FILE* file = fopen(temp_path, "wb");
+    if (!file) return;
+    int failed = fwrite(index->storage, 1, index->storage_size, file) != index->storage_size;
+    failed |= fclose(file) != 0;
+    if (failed || rename(temp_path, path)) remove(temp_path);
+}
+
+static void free_index(struct hlp_finish_index* index) {
+    if (!index) return;
+    for (int level = 0; level < index->layers; level++) {
+        for (int table = 0; table < HLP_FINISH_TABLES; table++) {
+            free(index->starts[level][table]);
+            free(index->ids[level][table]);
+        }
+    }
+    if (index->mapped) munmap(index->storage, index->storage_size);
+    else free(index->storage);
+    free(index);
+}
+
+struct hlp_finish_index* hlp_finish_index_get(int group, int layers, const char* dir) {
+    if (group < 1 || group > 16 || layers < 1 || layers > HLP_FINISH_MAX_LAYERS) return NULL;
+    struct hlp_finish_index* index = finish_index_history[group - 1];
+    if (index && index->layers >= layers) return index;
+    free_index(index);
+    finish_index_history[group - 1] = NULL;
+
+    // a directory too long to fit the file name is the same as none
+    char path[4096];
+    if (dir && snprintf(path, sizeof(path), "%s/hlpt-finish-g%d-k%d.bin", dir, group, layers) >= (int) sizeof(path))
+        dir = NULL;
+    if (dir) {
+        index = map_index_file(path, group, layers);
+        if (index) return finish_index_history[group - 1] = index;
+    }
+
+    index = build_index(group, layers, 0);
+    if (dir) {
+        write_index_file(path, index);
+        // swap over to the mapped copy so the pages can be shared and dropped
+        struct hlp_finish_index* mapped = map_index_file(path, group, layers);
+        if (mapped) {
+            free_index(index);
+            index = mapped;
+        }
+    }
+    return finish_index_history[group - 1] = index;
+}
+
+void hlp_finish_index_free_all() {
+    for (int i = 0; i < 16; i++) {
+        free_index(finish_index_history[i]);
+        finish_index_history[i] = NULL;
+    }
+    free_index(goal_index);
+    goal_index = NULL;
+}
+
+struct hlp_finish_index* hlp_finish_index_get_goal(int group, int layers, uint16_t required_values) {
+    if (group < 1 || group > 16 || layers < 1 || layers > HLP_FINISH_MAX_CHAIN || !required_values) return NULL;
+    if (goal_index &&
+            goal_index->group == group &&
+            goal_index->layers == layers &&
+            goal_index_values == required_values)
+        return goal_index;
+    free_index(goal_index);
+    goal_index = build_index(group, layers, required_values);
+    goal_index_values = required_values;
+    return goal_index;
+}
+
+/* find an entry in one level with every output within the given ranges,
+ * going through the table where that leaves the fewest buckets to check
+ */
+static const struct hlp_finish_entry* find_match(const struct hlp_finish_index* index, int level, const uint8_t* mins, const uint8_t* maxs) {
+    int best_table = 0;
+    long best_buckets = TABLE_BUCKETS + 1;
+    for (int table = 0; table < HLP_FINISH_TABLES; table++) {
+        long buckets = 1;
+        for (int value = table * 4; value < table * 4 + 4; value++)
+            buckets *= maxs[value] - mins[value] + 1;
+        if (buckets >= best_buckets) continue;
+        best_table = table;
+        best_buckets = buckets;
+    }
+
+    const struct hlp_finish_entry* entries = index->entries[level];
+    const uint32_t* starts = index->starts[level][best_table];
+    const uint32_t* ids = index->ids[level][best_table];
+    __m128i min_xmm = _mm_loadu_si128((const __m128i*) mins);
+    __m128i max_xmm = _mm_loadu_si128((const __m128i*) maxs);
+    const uint8_t* key_mins = mins + best_table * 4;
+    const uint8_t* key_maxs = maxs + best_table * 4;
+
+    for (int a = key_mins[0]; a <= key_maxs[0]; a++)
+    for (int b = key_mins[1]; b <= key_maxs[1]; b++)
+    for (int c = key_mins[2]; c <= key_maxs[2]; c++)
+    for (int d = key_mins[3]; d <= key_maxs[3]; d++) {
+        int bucket = (a << 12) | (b << 8) | (c << 4) | d;
+        for (uint32_t i = starts[bucket]; i < starts[bucket + 1]; i++) {
+            const struct hlp_finish_entry* entry = entries + (ids ? ids[i] : i);
+            __m128i outputs = big_endian_uint_to_xmm(entry->map);
+            __m128i misses = _mm_or_si128(_mm_cmpgt_epi8(min_xmm, outputs), _mm_cmpgt_epi8(outputs, max_xmm));
+            if (_mm_testz_si128(misses, misses)) return entry;
+        }
+    }
+    return NULL;
+}
+
+int hlp_finish_lookup(const struct hlp_finish_index* index, uint64_t map, const uint8_t* goal_min, const uint8_t* goal_max, int max_layers, uint16_t* chain) {
+    // work out what the rest of the chain needs to do with each value the
+    // map has, which leaves anything it doesn't have free
+    uint8_t inputs[16];
+    _mm_storeu_si128((__m128i*) inputs, unpack_uint_to_xmm(map));
+    uint8_t mins[16], maxs[16];
+    memset(mins, 0, sizeof(mins));
+    memset(maxs, 15, sizeof(maxs));
+    for (int x = 0; x < 16; x++) {
+        int value = inputs[x];
+        if (mins[value] < goal_min[x]) mins[value] = goal_min[x];
+        if (maxs[value] > goal_max[x]) maxs[value] = goal_max[x];
+        if (mins[value] > maxs[value]) return 0;
+    }
+
+    if (max_layers > index->layers) max_layers = index->layers;
+    for (int level = 0; level < max_layers; level++) {
+        const struct hlp_finish_entry* match = find_match(index, level, mins, maxs);
+        if (!match) continue;
+        memcpy(chain, match->chain, match->length * sizeof(uint16_t));
+        return match->length;
+    }
+    return 0;
+}
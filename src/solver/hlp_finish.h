@@ -0,0 +1,71 @@
+#ifndef HLP_FINISH_H
+#define HLP_FINISH_H
+#include <stddef.h>
+#include <stdint.h>
+
+/* finish index
+ *
+ * every unique map reachable from the identity in up to a few hex layers,
+ * along with the shortest chain that reaches it. it doesn't depend on the
+ * goal, only the group, so it can be built once and reused. with it, the
+ * search can stop that many layers early by looking up whether any of those
+ * maps takes the current map the rest of the way to the goal.
+ *
+ * the same layout also works for the goal's half of a bidirectional search,
+ * where everything that can't reach the goal is left out, leaving room for a
+ * few more layers.
+ */
+#define HLP_FINISH_MAX_LAYERS 3
+#define HLP_FINISH_MAX_CHAIN 7
+#define HLP_FINISH_TABLES 4
+
+struct hlp_finish_entry {
+    // big endian, so output 0 is in the top nibble. the index is sorted by this
+    uint64_t map;
+    uint16_t chain[HLP_FINISH_MAX_CHAIN];
+    uint16_t length;
+};
+
+struct hlp_finish_index {
+    int group, layers;
+    // entries[i] holds every map first reachable in i + 1 layers
+    const struct hlp_finish_entry* entries[HLP_FINISH_MAX_CHAIN];
+    long counts[HLP_FINISH_MAX_CHAIN];
+    // the entries bucketed by their outputs for 0-3, 4-7, 8-11 and 12-15, so
+    // lookups can start from whichever outputs they know the most about.
+    // entries are already in order for the first, so it has no ids
+    uint32_t* starts[HLP_FINISH_MAX_CHAIN][HLP_FINISH_TABLES];
+    uint32_t* ids[HLP_FINISH_MAX_CHAIN][HLP_FINISH_TABLES];
+    // where the entries live, either a mapped file or a plain allocation
+    void* storage;
+    size_t storage_size;
+    int mapped;
+};
+
+/* get the index covering up to the given number of layers for a group,
+ * building it on first use. if dir isn't NULL, the index gets memory mapped
+ * from a file there, which is written first if it doesn't exist yet
+ * returns NULL on failure
+ */
+struct hlp_finish_index* hlp_finish_index_get(int group, int layers, const char* dir);
+
+void hlp_finish_index_free_all();
+
+/* get an index of every chain of up to the given number of layers whose map
+ * still has every value in required_values among its outputs. nothing else
+ * can be the end of a chain that reaches a goal using those values, and since
+ * layers can only ever lose values, that prunes whole chains at once. only
+ * the last one asked for is kept around
+ * returns NULL on failure
+ */
+struct hlp_finish_index* hlp_finish_index_get_goal(int group, int layers, uint16_t required_values);
+
+/* find the shortest chain of up to max_layers layers that takes map to the
+ * goal, meaning for every x the chain's map R has
+ *     goal_min[x] <= R(map(x)) <= goal_max[x]
+ * the map is packed64, the goals one byte per x
+ * returns the length of the chain written out, 0 if there isn't one
+ */
+int hlp_finish_lookup(const struct hlp_finish_index* index, uint64_t map, const uint8_t* goal_min, const uint8_t* goal_max, int max_layers, uint16_t* chain);
+
+#endif
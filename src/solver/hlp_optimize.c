@@ -0,0 +1,46 @@
+#include "hlp_optimize.h"
+#include <string.h>
+#include "../redstone.h"
+#include "../vector_tools.h"
+
+/* the shortest chain of fewer than max_length layers that takes every value
+ * the first map has to where the second one has it
+ * returns its length, -1 if there isn't one
+ */
+static int find_replacement(const struct hlp_finish_index* index, uint64_t from, uint64_t to, int max_length, uint16_t* replacement) {
+    // the window doesn't do anything to the values that get there
+    if (from == to) return 0;
+    if (!max_length) return -1;
+
+    uint8_t goal[16];
+    _mm_storeu_si128((__m128i*) goal, unpack_uint_to_xmm(to));
+    int length = hlp_finish_lookup(index, from, goal, goal, max_length, replacement);
+    return length ? length : -1;
+}
+
+int hlp_optimize_chain(uint16_t* chain, int length, int max_window, const struct hlp_finish_index* index) {
+    // maps[i] is what the first i layers do
+    uint64_t maps[HLP_OPTIMIZE_MAX_LENGTH + 1];
+    int improved = 1;
+    while (improved) {
+        improved = 0;
+        maps[0] = IDENTITY_PERM_PK64;
+        for (int i = 0; i < length; i++) maps[i + 1] = hex_layer64(maps[i], chain[i]);
+
+        // the longest windows first, since they have the most to gain
+        for (int window = max_window < length ? max_window : length; window > 0 && !improved; window--) {
+            for (int start = 0; start + window <= length; start++) {
+                uint16_t replacement[HLP_FINISH_MAX_CHAIN];
+                int replacement_length = find_replacement(index, maps[start], maps[start + window], window - 1, replacement);
+                if (replacement_length < 0) continue;
+
+                memmove(chain + start + replacement_length, chain + start + window, (length - start - window) * sizeof(uint16_t));
+                memcpy(chain + start, replacement, replacement_length * sizeof(uint16_t));
+                length -= window - replacement_length;
+                improved = 1;
+                break;
+            }
+        }
+    }
+    return length;
+}
@@ -0,0 +1,23 @@
+#ifndef HLP_OPTIMIZE_H
+#define HLP_OPTIMIZE_H
+#include <stdint.h>
+#include "hlp_finish.h"
+
+/* peephole optimizer for hex chains
+ *
+ * a window of layers in the middle of a chain only has to do the same thing
+ * to the values that actually make it there, so it can be swapped out for any
+ * shorter chain that does. the finish index already holds the shortest chain
+ * for every map within a few layers, and looking up what the window does to
+ * those values finds the shortest one that fits. the chain as a whole still
+ * gives the exact same map afterwards.
+ */
+#define HLP_OPTIMIZE_MAX_LENGTH 256
+
+/* shorten the chain in place, trying every window of up to max_window layers
+ * over and over until none of them can be made any shorter
+ * returns the new length
+ */
+int hlp_optimize_chain(uint16_t* chain, int length, int max_window, const struct hlp_finish_index* index);
+
+#endif
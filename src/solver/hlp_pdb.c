@@ -0,0 +1,126 @@
+#include "hlp_pdb.h"
+#include <stdlib.h>
+#include <string.h>
+#include "../redstone.h"
+
+#define PDB_STATES (1 << 16)
+// how many tables are kept around for later goals
+#define PDB_HISTORY_SIZE 32
+
+struct pdb_table {
+    // the group and goal it was built for, 0 if unused
+    uint64_t key;
+    uint8_t* distances;
+};
+
+static struct pdb_table pdb_history[PDB_HISTORY_SIZE] = { 0 };
+static int pdb_history_next = 0;
+
+/* the input held in each nibble of a 16 bit chunk, from the bottom. chunk k
+ * covers bytes 2k and 2k+1, where the low nibble of a byte is input 8 higher
+ */
+static int chunk_input(int quarter, int nibble) {
+    return 2 * quarter + (nibble >> 1) + (nibble & 1 ? 0 : 8);
+}
+
+/* how far every state is from the goal, relaxing everything not yet reached
+ * once per distance. every layer acts on a chunk a byte at a time, so they
+ * get turned into byte tables first
+ */
+static uint8_t* build_table(int group, const uint8_t* mins, const uint8_t* maxs) {
+    struct precomputed_hex_layer* identity_layer = precompute_hex_layers(group, 1);
+    int layer_count = identity_layer->next_layer_count;
+    uint8_t (*byte_tables)[256] = malloc(layer_count * sizeof(*byte_tables));
+    uint8_t* distances = malloc(PDB_STATES);
+    uint16_t* pending = malloc(PDB_STATES * sizeof(uint16_t));
+    if (!byte_tables || !distances || !pending) {
+        free(byte_tables);
+        free(distances);
+        free(pending);
+        return NULL;
+    }
+
+    for (int i = 0; i < layer_count; i++) {
+        uint64_t map = identity_layer->next_layers[i]->map;
+        uint8_t values[16];
+        for (int value = 0; value < 16; value++)
+            values[value] = (map >> (value < 8 ? 8 * value + 4 : 8 * (value - 8))) & 15;
+        for (int byte = 0; byte < 256; byte++)
+            byte_tables[i][byte] = values[byte & 15] | (values[byte >> 4] << 4);
+    }
+
+    int pending_count = 0;
+    for (int state = 0; state < PDB_STATES; state++) {
+        int reached = 1, split = 0;
+        for (int nibble = 0; nibble < 4; nibble++) {
+            int value = (state >> (4 * nibble)) & 15;
+            reached &= value >= mins[nibble] && value <= maxs[nibble];
+            // layers never split up equal values, so those need goals in common
+            for (int other = 0; other < nibble; other++)
+                split |= value == ((state >> (4 * other)) & 15) && (mins[nibble] > maxs[other] || mins[other] > maxs[nibble]);
+        }
+        distances[state] = reached ? 0 : HLP_PDB_UNREACHABLE;
+        if (!reached && !split) pending[pending_count++] = state;
+    }
+
+    for (int distance = 0; distance < HLP_PDB_UNREACHABLE - 1; distance++) {
+        int remaining_count = 0;
+        for (int i = 0; i < pending_count; i++) {
+            int state = pending[i];
+            int lo = state & 0xff;
+            int hi = state >> 8;
+            int j = 0;
+            while (j < layer_count && distances[byte_tables[j][lo] | (byte_tables[j][hi] << 8)] != distance) j++;
+            // anything set here isn't equal to distance, so it can't be
+            // mistaken for this round's states
+            if (j < layer_count) distances[state] = distance + 1;
+            else pending[remaining_count++] = state;
+        }
+        if (remaining_count == pending_count) break;
+        pending_count = remaining_count;
+    }
+
+    free(pending);
+    free(byte_tables);
+    return distances;
+}
+
+// the table for one quarter, building it if it isn't around yet
+static const uint8_t* get_table(int group, const uint8_t* mins, const uint8_t* maxs) {
+    uint64_t key = group;
+    for (int nibble = 0; nibble < 4; nibble++)
+        key = (key << 8) | (mins[nibble] << 4) | maxs[nibble];
+
+    for (int i = 0; i < PDB_HISTORY_SIZE; i++)
+        if (pdb_history[i].key == key) return pdb_history[i].distances;
+
+    uint8_t* distances = build_table(group, mins, maxs);
+    if (!distances) return NULL;
+    struct pdb_table* slot = pdb_history + pdb_history_next;
+    pdb_history_next = (pdb_history_next + 1) % PDB_HISTORY_SIZE;
+    free(slot->distances);
+    slot->key = key;
+    slot->distances = distances;
+    return distances;
+}
+
+int hlp_pdb_init(struct hlp_pdb* pdb, int group, const uint8_t* goal_min, const uint8_t* goal_max) {
+    for (int quarter = 0; quarter < HLP_PDB_QUARTERS; quarter++) {
+        uint8_t mins[4], maxs[4];
+        for (int nibble = 0; nibble < 4; nibble++) {
+            mins[nibble] = goal_min[chunk_input(quarter, nibble)];
+            maxs[nibble] = goal_max[chunk_input(quarter, nibble)];
+        }
+        pdb->distances[quarter] = get_table(group, mins, maxs);
+        if (!pdb->distances[quarter]) return 1;
+    }
+    return 0;
+}
+
+void hlp_pdb_free_all() {
+    for (int i = 0; i < PDB_HISTORY_SIZE; i++) {
+        free(pdb_history[i].distances);
+        pdb_history[i].key = 0;
+        pdb_history[i].distances = NULL;
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef HLP_PDB_H
+#define HLP_PDB_H
+#include <stdint.h>
+
+/* quarter pattern databases
+ *
+ * layers act on each value on its own, so any 4 inputs of a map can be
+ * followed through a chain without the rest of them. for each group of 4
+ * inputs sharing a 16 bit chunk of a packed64 map (2k, 2k+1, 2k+8 and 2k+9
+ * for chunk k), a table holds how many layers it takes at least to get all
+ * 4 of them within the goal. the largest of the 4 is then a lower bound on
+ * how many layers the whole map is from the goal.
+ */
+#define HLP_PDB_QUARTERS 4
+// for when the quarter can't ever reach the goal
+#define HLP_PDB_UNREACHABLE 0xff
+
+struct hlp_pdb {
+    const uint8_t* distances[HLP_PDB_QUARTERS];
+};
+
+/* get the tables for a goal, given one byte per input. tables are kept
+ * around, so quarters and goals asking for the same thing share them
+ * returns 1 on failure
+ */
+int hlp_pdb_init(struct hlp_pdb* pdb, int group, const uint8_t* goal_min, const uint8_t* goal_max);
+
+void hlp_pdb_free_all();
+
+// the fewest layers it could take for the packed64 map to reach the goal
+static inline int hlp_pdb_bound(const struct hlp_pdb* pdb, uint64_t map) {
+    int bound = pdb->distances[0][map & 0xffff];
+    for (int quarter = 1; quarter < HLP_PDB_QUARTERS; quarter++) {
+        int distance = pdb->distances[quarter][(map >> (16 * quarter)) & 0xffff];
+        if (distance > bound) bound = distance;
+    }
+    return bound;
+}
+
+#endif
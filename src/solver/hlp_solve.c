@@ -7,34 +7,287 @@
 #include <immintrin.h>
 #include "../aa_tree.h"
 #include "hlp_solve.h"
+#include "hlp_finish.h"
+#include "hlp_pdb.h"
 #include <stdbool.h>
 #include "../bitonic_sort.h"
 #include "../vector_tools.h"
 #include "../redstone.h"
 #include "../cache.h"
+#include "../work_pool.h"
+#include <stdatomic.h>
+
+// searches shallower than this aren't worth waking up the other threads for
+#define PARALLEL_MIN_DEPTH 6
+// nodes this deep or shallower always get their children split into tasks
+#define PARALLEL_SPLIT_DEPTH 2
+// below that, subtrees with fewer remaining layers are never split off
+#define PARALLEL_MIN_SPLIT_REMAINING 3
+
+// how many leaves get gathered up before they are searched in one go
+#define LEAF_BATCH_SIZE 256
+// room to look up everything waiting on the leaf queue, must be a power of 2
+#define LEAF_WAITING_SLOTS (LEAF_BATCH_SIZE * 4)
+// how many times the search checks if it should stop between looking at the clock
+#define DEADLINE_CHECK_INTERVAL 4096
+
+// the most outputs a goal can care about for the compact engine, which
+// keeps a nibble for each in a 32 bit key
+#define COMPACT_WIDTH 8
+// room to deduplicate every child of a node, must be a power of 2
+#define COMPACT_DEDUP_BITS 12
+#define COMPACT_DEDUP_SLOTS (1 << COMPACT_DEDUP_BITS)
+
+// set on staged branches that the presearch would have pruned
+#define BRANCH_EXTRA 0x8000
+#define BRANCH_INDEX_MASK 0x7fff
+
+// what a node's path has in common with the presearch
+enum search_path {
+    // every branch on the way here was also searched by the presearch
+    PATH_COVERED = 1,
+    // the way here is a prefix of the chain the presearch found
+    PATH_ON_PRESEARCH_CHAIN = 2,
+};
+
+// how the search decides what to look at next
+enum hlp_engine {
+    // plain iterative deepening on chain length
+    HLP_ENGINE_DEPTH,
+    // iterative deepening on the length so far plus the distance estimate,
+    // searching the children closest to the goal first
+    HLP_ENGINE_IDA,
+    // only keep the best few chains at each length, see beam_search
+    HLP_ENGINE_BEAM,
+    // the depth engine, but only following the outputs the goal cares
+    // about, see compact_dfs
+    HLP_ENGINE_COMPACT,
+};
+
+// what to do once the shortest length is known
+enum hlp_solutions {
+    // stop at the first chain found
+    HLP_SOLUTIONS_FIRST,
+    // go through every chain of that length, printing each one
+    HLP_SOLUTIONS_ALL,
+    // same, but only count them
+    HLP_SOLUTIONS_COUNT,
+};
+
+struct hlp_parallel_search;
+
+// a chain kept by the beam search
+struct hlp_beam_node {
+    uint64_t map;
+    uint64_t hash;
+    struct precomputed_hex_layer* layer;
+    // where the chain it came from is in the last beam
+    int parent;
+    // lower is better, the separations then how many outputs are off
+    uint16_t score;
+};
+
+// a node one layer from the end, waiting to be searched along with others
+struct hlp_leaf {
+    uint64_t map;
+    uint64_t hash;
+    struct precomputed_hex_layer* layer;
+    // the layers leading to its parent and to itself
+    uint16_t parent_config, config;
+};
+
+/* every layer as a table of what it gives each value, for the compact engine.
+ * by value then layer, so the children of a map can be read off a block of 8
+ * layers at a time, one value at a time
+ */
+struct hlp_compact_layers {
+    int layer_count;
+    // rounded up to a whole number of blocks, repeating the last layer
+    int padded_count;
+    uint16_t* configs;
+    uint8_t* columns;
+};
+
+// the same as hlp_branch, but for the compact engine
+struct hlp_compact_branch {
+    uint64_t hash;
+    uint32_t key;
+    uint16_t index;
+    uint8_t separations;
+};
+
+// a child that passed the checks, staged to be searched
+struct hlp_branch {
+    uint64_t map;
+    // for the cache, worked out ahead of time so the bucket can be prefetched
+    uint64_t hash;
+    // index into next_layers, along with BRANCH_EXTRA
+    uint16_t index;
+    // what the distance check found, see get_dist_estimate
+    uint8_t separations;
+};
 
 struct hlp_solve_globals {
     struct __config__ {
         __m256i goal_min, goal_max, dont_care_mask, dont_care_post_sort_perm;
         int solve_type, dont_care_count, current_bfs_depth, group, accuracy;
+        // the copy of the layer check kernel for solve_type, picked once in
+        // init_goal, see batch_apply_and_check_exact
+        int (*apply_and_check)(struct hlp_solve_globals* globals, struct precomputed_hex_layer* layer, const uint64_t* luts,
+                struct hlp_branch* outputs, uint64_t input, int threshhold, int covered_threshhold);
+        // the outputs of a packed64 map the goal cares about. maps that
+        // agree on those are the same as far as the goal goes, so the cache
+        // only looks at those, see get_map_hash
+        uint64_t projection;
+        enum hlp_engine engine;
+        // how many chains the beam search keeps at each length
+        int beam_width;
+        // take two layers per call, see macro_step
+        int macro_step;
+        // every depth up to covered_depth was already searched exhaustively
+        // with covered_accuracy, which prunes the same as this search for
+        // up to covered_limit remaining layers
+        int covered_depth, covered_accuracy, covered_limit;
+        int presearch_length;
+        uint16_t presearch_chain[32];
+        // the last finish_layers layers get looked up instead of searched
+        int finish_layers;
+        const struct hlp_finish_index* finish_index;
+        uint8_t finish_goal_min[16], finish_goal_max[16];
+        // a lower bound on the distance to the goal, on top of the distance
+        // check, when use_pdb is set
+        int use_pdb;
+        struct hlp_pdb pdb;
+        // when to give up on the search in wall clock seconds, 0 for never
+        double deadline;
+        // the goal projected onto the outputs it cares about, for the
+        // compact engine. nibble j of a key is the output for
+        // compact_inputs[j], and goals with fewer outputs than that repeat
+        // the last one
+        const struct hlp_compact_layers* compact_layers;
+        uint8_t compact_inputs[COMPACT_WIDTH];
+        uint32_t compact_start, compact_goal;
     } config;
 
     struct __output__ {
         uint16_t* chain;
         int chain_length;
-        int solutions_found;
+        // -1 unless every solution is being gone through, see
+        // enumerate_solutions
+        long solutions_found;
+        // print each of them as they're found
+        int print_solutions;
+        // the path currently being searched, only copied to chain once it
+        // turns out to be a solution
+        uint16_t working_chain[32];
     } output;
 
     struct __stats__ {
         long total_iterations;
+        // the same, split up by the depth of the maps being checked
+        long depth_iterations[32];
+        // how many times the leaf queue got searched, see flush_leaves
+        long leaf_batches;
+        // checks left until the clock gets looked at again
+        int deadline_countdown;
+        // the deadline passed, everything since then got cut short
+        int timed_out;
         clock_t start_time;
     } stats;
+
+    struct __parallel__ {
+        struct hlp_parallel_search* search;
+        int worker_id;
+        struct hlp_branch* staged_branches;
+        // how many tasks this worker has split off. a node whose subtree
+        // split off any isn't done when dfs returns, so it can't be stored
+        long split_count;
+    } parallel;
+
+    struct cache_stats* cache_stats;
+
+    struct __leaves__ {
+        struct hlp_leaf queue[LEAF_BATCH_SIZE];
+        int count;
+        // hashes of the parents of those leaves, which can't be stored in the
+        // cache until their leaves have been searched
+        uint64_t pending_parents[LEAF_BATCH_SIZE];
+        int pending_count;
+        // everything above by hash, so that transpositions of a node that's
+        // already waiting can be skipped. 0 remaining layers means empty
+        struct __waiting__ {
+            uint64_t hash;
+            int remaining;
+        } waiting[LEAF_WAITING_SLOTS];
+    } leaves;
+};
+
+// a subtree split off for some worker to search
+struct hlp_task {
+    uint64_t map;
+    struct precomputed_hex_layer* layer;
+    int depth;
+    int path;
+    uint16_t chain[32];
+};
+
+#define MULTI_BITMAP_WORDS ((HEX_CONFIG_COUNT + 63) / 64)
+
+// several goals sharing one search, see solve_multi
+struct hlp_multi_search {
+    // one set of globals per goal, only the config and output get used
+    struct hlp_solve_globals* goals;
+    int goal_count;
+    // how many still need a chain
+    int unsolved_count;
+    // the goals being searched for at each depth, and which children
+    // passed for each of them, see multi_dfs
+    int* goal_lists;
+    uint64_t* passed;
+    uint16_t (*chains)[32];
+    int* lengths;
+    int current_bfs_depth;
+    uint16_t working_chain[32];
+    // the last finish_layers layers get looked up for each goal
+    int finish_layers;
+    const struct hlp_finish_index* finish_index;
+    struct cache_stats* cache_stats;
+    long total_iterations;
+};
+
+// what the compact engine needs on top of the globals, see compact_dfs
+struct hlp_compact_search {
+    // the children of the node being expanded by key, anything without the
+    // current stamp is empty
+    uint32_t dedup_keys[COMPACT_DEDUP_SLOTS];
+    uint32_t dedup_stamps[COMPACT_DEDUP_SLOTS];
+    uint32_t stamp;
+};
+
+struct hlp_parallel_search {
+    struct work_pool* pool;
+    struct hlp_solve_globals* workers;
+    int thread_count;
+    atomic_int found;
+    int chain_length;
+    uint16_t chain[32];
 };
 
 static int verbosity = 1;
 
 int global_max_depth;
 int global_accuracy;
+int global_thread_count;
+int global_finish_layers;
+int global_meet_layers;
+int global_use_pdb;
+int global_macro_step;
+enum hlp_solutions global_solutions;
+int global_certify_length;
+double global_time_limit;
+int global_beam_width;
+enum hlp_engine global_engine;
+char* global_finish_dir;
 
 int is_hex(char c) {
     return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f');
@@ -45,10 +298,10 @@ int to_hex(char c) {
 }
 
 int map_pair_contains_ranges(uint64_t mins, uint64_t maxs) {
-    while (mins && maxs) {
+    for (int i = 0; i < 16; i++) {
         int min_val = mins & 15;
         int max_val = maxs & 15;
-        if (min_val != min_val && !(min_val == 0 && max_val == 15)) return 1;
+        if (min_val != max_val && !(min_val == 0 && max_val == 15)) return 1;
         mins >>= 4;
         maxs >>= 4;
     }
@@ -140,12 +393,17 @@ static ymm_pair_t combine_ranges(__m256i equality_reference, ymm_pair_t mins_and
     COMBINE_RANGES_INNER(8, l, r);
 
     mins_and_maxs.ymm1 = _mm256_xor_si256(mins_and_maxs.ymm1, UINT256_MAX);
+    return mins_and_maxs;
 }
 
-static int get_legal_dist_check_mask_ranged(struct hlp_solve_globals* globals, __m256i sorted_ymm, int threshhold) {
+/* bits 0 and 2 are set for each map that can still reach the goal at all,
+ * with how many separations each of them is missing written to separations
+ * at the same offsets
+ */
+static inline __attribute__((always_inline)) int get_legal_separations_ranged(__m256i goal_min, __m256i goal_max, __m256i sorted_ymm, uint8_t* separations) {
     __m256i final_indices = _mm256_and_si256(sorted_ymm, LO_HALVES_4_256);
     __m256i current = _mm256_and_si256(_mm256_srli_epi64(sorted_ymm, 4), LO_HALVES_4_256);
-    ymm_pair_t final = {_mm256_shuffle_epi8(globals->config.goal_min, final_indices), _mm256_shuffle_epi8(globals->config.goal_max, final_indices)};
+    ymm_pair_t final = {_mm256_shuffle_epi8(goal_min, final_indices), _mm256_shuffle_epi8(goal_max, final_indices)};
     final = combine_ranges(current, final);
 
     // if the min is higher than the max, that's all we need to know
@@ -160,11 +418,12 @@ static int get_legal_dist_check_mask_ranged(struct hlp_solve_globals* globals, _
     __m256i current_delta = _mm256_abs_epi8(_mm256_sub_epi8(_mm256_srli_si256(current, 1), current));
 
     uint32_t separations_mask = _mm256_movemask_epi8(_mm256_cmpgt_epi8(final_delta, current_delta)) & 0x7fff7fff;
-    mask &= (_popcnt32(separations_mask & 0xffff) <= threshhold) | ((_popcnt32(separations_mask >> 16) <= threshhold) << 2);
+    separations[0] = _popcnt32(separations_mask & 0xffff);
+    separations[2] = _popcnt32(separations_mask >> 16);
     return mask;
 }
 
-static int get_legal_dist_check_mask_partial(struct hlp_solve_globals* globals, __m256i sorted_ymm, int threshhold) {
+static inline __attribute__((always_inline)) int get_legal_separations_partial(__m256i sorted_ymm, uint8_t* separations) {
     __m256i final = _mm256_and_si256(sorted_ymm, LO_HALVES_4_256);
     __m256i current = _mm256_and_si256(_mm256_srli_epi64(sorted_ymm, 4), LO_HALVES_4_256);
 
@@ -177,29 +436,50 @@ static int get_legal_dist_check_mask_partial(struct hlp_solve_globals* globals,
     mask &= _mm256_testz_si256(LO_HALVES_128_256, illegals) | (_mm256_testc_si256(LO_HALVES_128_256, illegals) << 2);
 
     uint32_t separations_mask = _mm256_movemask_epi8(_mm256_cmpgt_epi8(final_delta, current_delta)) & 0x7fff7fff;
-    mask &= (_popcnt32(separations_mask & 0xffff) <= threshhold) | ((_popcnt32(separations_mask >> 16) <= threshhold) << 2);
+    separations[0] = _popcnt32(separations_mask & 0xffff);
+    separations[2] = _popcnt32(separations_mask >> 16);
     return mask;
 }
 
-static int batch_apply_and_check_exact(
+// the cache key for a map
+static uint64_t get_map_hash(struct hlp_solve_globals* globals, uint64_t map) {
+    return cache_hash(map & globals->config.projection);
+}
+
+/* the kernel behind batch_apply_and_check_exact, which gets built once for
+ * each solve type. solve_type is always a constant, so everything that
+ * doesn't apply to it drops out, and the goal is kept in registers
+ */
+static inline __attribute__((always_inline)) int apply_and_check_inner(
         struct hlp_solve_globals* globals,
         struct precomputed_hex_layer* layer,
-        uint16_t* outputs,
+        const uint64_t* luts,
+        struct hlp_branch* outputs,
         uint64_t input,
-        int threshhold) {
+        int threshhold,
+        int covered_threshhold,
+        const int solve_type) {
     __m256i doubled_input = _mm256_permute4x64_epi64(_mm256_castsi128_si256(unpack_uint_to_xmm(input)), 0x44);
-
-    // this contains extra bits to overwrite the current value on dont care entries
+    __m256i goal_min = globals->config.goal_min;
+    __m256i goal_max = globals->config.goal_max;
+    __m256i post_sort_perm = globals->config.dont_care_post_sort_perm;
+
+    // this contains extra bits to overwrite the current value on dont care
+    // entries, so they sort to the end where dont_care_post_sort_perm drops
+    // them. ranged goals sort on the index instead, to look up both ends.
+    // exact goals don't have any dont cares to begin with
     __m256i doubled_goal;
-    if (globals->config.solve_type == HLP_SOLVE_TYPE_RANGED) 
-        doubled_goal = SHUFB_IDENTITY_256;
+    if (solve_type == HLP_SOLVE_TYPE_RANGED)
+        doubled_goal = _mm256_or_si256(SHUFB_IDENTITY_256, globals->config.dont_care_mask);
+    else if (solve_type == HLP_SOLVE_TYPE_PARTIAL)
+        doubled_goal = _mm256_or_si256(goal_min, globals->config.dont_care_mask);
     else
-        doubled_goal = _mm256_or_si256(globals->config.goal_min, globals->config.dont_care_mask);
+        doubled_goal = goal_min;
 
-    uint16_t* current_output = outputs;
+    struct hlp_branch* current_output = outputs;
 
     for (int i = (layer->next_layer_count - 1) / 4; i >= 0; i--) {
-        ymm_pair_t quad = quad_unpack_map256(_mm256_loadu_si256(((__m256i*) layer->next_layer_luts) + i));
+        ymm_pair_t quad = quad_unpack_map256(_mm256_loadu_si256(((__m256i*) luts) + i));
         quad.ymm0 = _mm256_shuffle_epi8(quad.ymm0, doubled_input);
         quad.ymm1 = _mm256_shuffle_epi8(quad.ymm1, doubled_input);
 
@@ -207,23 +487,216 @@ static int batch_apply_and_check_exact(
             _mm256_or_si256(doubled_goal, _mm256_slli_epi64(quad.ymm1, 4)) };
         sorted_quad = bitonic_sort4x16x8_inner(sorted_quad);
 
-        sorted_quad.ymm0 = _mm256_shuffle_epi8(sorted_quad.ymm0, globals->config.dont_care_post_sort_perm);
-        sorted_quad.ymm1 = _mm256_shuffle_epi8(sorted_quad.ymm1, globals->config.dont_care_post_sort_perm);
-        int mask;
-        if (globals->config.solve_type == HLP_SOLVE_TYPE_RANGED)
-            mask = get_legal_dist_check_mask_ranged(globals, sorted_quad.ymm0, threshhold) | (get_legal_dist_check_mask_ranged(globals, sorted_quad.ymm1, threshhold) << 1);
+        if (solve_type != HLP_SOLVE_TYPE_EXACT) {
+            sorted_quad.ymm0 = _mm256_shuffle_epi8(sorted_quad.ymm0, post_sort_perm);
+            sorted_quad.ymm1 = _mm256_shuffle_epi8(sorted_quad.ymm1, post_sort_perm);
+        }
+        uint8_t separations[4];
+        int legal;
+        if (solve_type == HLP_SOLVE_TYPE_RANGED)
+            legal = get_legal_separations_ranged(goal_min, goal_max, sorted_quad.ymm0, separations) | (get_legal_separations_ranged(goal_min, goal_max, sorted_quad.ymm1, separations + 1) << 1);
         else
-            mask = get_legal_dist_check_mask_partial(globals, sorted_quad.ymm0, threshhold) | (get_legal_dist_check_mask_partial(globals, sorted_quad.ymm1, threshhold) << 1);
+            legal = get_legal_separations_partial(sorted_quad.ymm0, separations) | (get_legal_separations_partial(sorted_quad.ymm1, separations + 1) << 1);
+        legal &= quad_valid_lanes(i * 4, layer->next_layer_count);
+
+        // bits 0-3 for the maps that pass, 4-7 for the ones that would also
+        // pass with covered_threshhold
+        int mask = 0;
+        for (int j = 0; j < 4; j++)
+            mask |= ((separations[j] <= threshhold) | ((separations[j] <= covered_threshhold) << 4)) << j;
+        mask &= legal * 0x11;
+        mask &= (mask << 4) | 15;
         if (i & (mask == 0)) continue;
-        __m256i packed = quad_pack_map256(quad);
+        uint64_t maps[4];
+        _mm256_storeu_si256((__m256i*) maps, quad_pack_map256(quad));
 
+        int extra = ~mask >> 4;
         for (int j = 3; j >= 0; j--) {
-            *current_output = i * 4 + j;
+            current_output->map = maps[j];
+            current_output->separations = separations[j];
+            current_output->index = (i * 4 + j) | (((extra >> j) & 1) * BRANCH_EXTRA);
+            current_output += (mask >> j) & 1;
+        }
+    }
+
+    // get every bucket on its way now so the misses overlap, in the order
+    // the branches get searched. exact goals care about the whole map
+    int count = current_output - outputs;
+    for (int i = count - 1; i >= 0; i--) {
+        outputs[i].hash = solve_type == HLP_SOLVE_TYPE_EXACT ? cache_hash(outputs[i].map) : get_map_hash(globals, outputs[i].map);
+        cache_prefetch(&main_cache, outputs[i].hash);
+    }
+    return count;
+}
+
+#ifdef USE_AVX512
+/* get_legal_separations_partial for the 4 lanes of a zmm. this gives the
+ * bytes that rule out each lane instead, so lanes with none of them set can
+ * still reach the goal, see octa_empty_lanes
+ */
+static inline __attribute__((always_inline)) __mmask64 get_illegal_separations_partial512(__m512i sorted_zmm, uint8_t* separations) {
+    const __m512i nibble_mask = _mm512_set1_epi8(15);
+    // every byte but the last of each lane, which doesn't have a next one
+    const __mmask64 low_15_bytes = 0x7fff7fff7fff7fff;
+    __m512i final = _mm512_and_si512(sorted_zmm, nibble_mask);
+    __m512i current = _mm512_and_si512(_mm512_srli_epi64(sorted_zmm, 4), nibble_mask);
+
+    __m512i final_delta = _mm512_abs_epi8(_mm512_sub_epi8(_mm512_bsrli_epi128(final, 1), final));
+    __m512i current_delta = _mm512_abs_epi8(_mm512_sub_epi8(_mm512_bsrli_epi128(current, 1), current));
+
+    __mmask64 illegals = _mm512_mask_test_epi8_mask(_mm512_testn_epi8_mask(current_delta, current_delta) & low_15_bytes, final_delta, final_delta);
+    __mmask64 separations_mask = _mm512_cmpgt_epi8_mask(final_delta, current_delta) & low_15_bytes;
+    for (int k = 0; k < 4; k++)
+        separations[k] = _popcnt32((separations_mask >> (16 * k)) & 0xffff);
+    return illegals;
+}
+
+#define COMBINE_RANGES_INNER512(shift, s1, s2)\
+    mask = _mm512_cmpeq_epi8_mask(equality_reference, _mm512_b##s1##li_epi128(equality_reference, shift));\
+    mins_and_maxs.zmm0 = _mm512_max_epu8(mins_and_maxs.zmm0, _mm512_b##s2##li_epi128(_mm512_maskz_mov_epi8(mask, mins_and_maxs.zmm0), shift));\
+    mins_and_maxs.zmm1 = _mm512_max_epu8(mins_and_maxs.zmm1, _mm512_b##s2##li_epi128(_mm512_maskz_mov_epi8(mask, mins_and_maxs.zmm1), shift));\
+
+// combine_ranges for the 4 lanes of a zmm pair
+static inline __attribute__((always_inline)) zmm_pair_t combine_ranges512(__m512i equality_reference, zmm_pair_t mins_and_maxs) {
+    mins_and_maxs.zmm1 = _mm512_xor_si512(mins_and_maxs.zmm1, _mm512_set1_epi8(-1));
+    __mmask64 mask;
+
+    COMBINE_RANGES_INNER512(1, sr, sl);
+    COMBINE_RANGES_INNER512(2, sr, sl);
+    COMBINE_RANGES_INNER512(4, sr, sl);
+    COMBINE_RANGES_INNER512(8, sr, sl);
+
+    COMBINE_RANGES_INNER512(1, sl, sr);
+    COMBINE_RANGES_INNER512(2, sl, sr);
+    COMBINE_RANGES_INNER512(4, sl, sr);
+    COMBINE_RANGES_INNER512(8, sl, sr);
+
+    mins_and_maxs.zmm1 = _mm512_xor_si512(mins_and_maxs.zmm1, _mm512_set1_epi8(-1));
+    return mins_and_maxs;
+}
+
+// get_legal_separations_ranged for the 4 lanes of a zmm, in the same form as get_illegal_separations_partial512
+static inline __attribute__((always_inline)) __mmask64 get_illegal_separations_ranged512(__m512i goal_min, __m512i goal_max, __m512i sorted_zmm, uint8_t* separations) {
+    const __m512i nibble_mask = _mm512_set1_epi8(15);
+    const __mmask64 low_15_bytes = 0x7fff7fff7fff7fff;
+    __m512i final_indices = _mm512_and_si512(sorted_zmm, nibble_mask);
+    __m512i current = _mm512_and_si512(_mm512_srli_epi64(sorted_zmm, 4), nibble_mask);
+    zmm_pair_t final = {_mm512_shuffle_epi8(goal_min, final_indices), _mm512_shuffle_epi8(goal_max, final_indices)};
+    final = combine_ranges512(current, final);
+
+    __mmask64 illegals = _mm512_cmpgt_epi8_mask(final.zmm0, final.zmm1);
+
+    __m512i final_delta = _mm512_max_epi8(
+            _mm512_sub_epi8(final.zmm0, _mm512_bsrli_epi128(final.zmm1, 1)),
+            _mm512_sub_epi8(_mm512_bsrli_epi128(final.zmm0, 1), final.zmm1)
+            );
+    __m512i current_delta = _mm512_abs_epi8(_mm512_sub_epi8(_mm512_bsrli_epi128(current, 1), current));
+
+    __mmask64 separations_mask = _mm512_cmpgt_epi8_mask(final_delta, current_delta) & low_15_bytes;
+    for (int k = 0; k < 4; k++)
+        separations[k] = _popcnt32((separations_mask >> (16 * k)) & 0xffff);
+    return illegals;
+}
+
+// apply_and_check_inner, 8 maps at a time
+static inline __attribute__((always_inline)) int apply_and_check_inner512(
+        struct hlp_solve_globals* globals,
+        struct precomputed_hex_layer* layer,
+        const uint64_t* luts,
+        struct hlp_branch* outputs,
+        uint64_t input,
+        int threshhold,
+        int covered_threshhold,
+        const int solve_type) {
+    octa_input_t octa_input = octa_prepare_input512(input);
+    __m512i goal_min = QUAD_XMM(_mm256_castsi256_si128(globals->config.goal_min));
+    __m512i goal_max = QUAD_XMM(_mm256_castsi256_si128(globals->config.goal_max));
+    __m512i goal = goal_min;
+    if (solve_type == HLP_SOLVE_TYPE_RANGED)
+        goal = QUAD_XMM(_mm256_castsi256_si128(_mm256_or_si256(SHUFB_IDENTITY_256, globals->config.dont_care_mask)));
+    else if (solve_type == HLP_SOLVE_TYPE_PARTIAL)
+        goal = _mm512_or_si512(goal, QUAD_XMM(_mm256_castsi256_si128(globals->config.dont_care_mask)));
+    __m512i post_sort_perm = QUAD_XMM(_mm256_castsi256_si128(globals->config.dont_care_post_sort_perm));
+
+    struct hlp_branch* current_output = outputs;
+    int count = layer->next_layer_count;
+
+    for (int i = (count - 1) / 8; i >= 0; i--) {
+        zmm_pair_t octa = octa_apply_map512(_mm512_loadu_si512(luts + 8 * i), octa_input);
+        zmm_pair_t sorted_octa = { _mm512_or_si512(goal, _mm512_slli_epi64(octa.zmm0, 4)),
+            _mm512_or_si512(goal, _mm512_slli_epi64(octa.zmm1, 4)) };
+        sorted_octa = bitonic_sort8x16x8_inner(sorted_octa);
+
+        if (solve_type != HLP_SOLVE_TYPE_EXACT) {
+            sorted_octa.zmm0 = _mm512_shuffle_epi8(sorted_octa.zmm0, post_sort_perm);
+            sorted_octa.zmm1 = _mm512_shuffle_epi8(sorted_octa.zmm1, post_sort_perm);
+        }
+        uint8_t separations[8];
+        __mmask64 illegals0, illegals1;
+        if (solve_type == HLP_SOLVE_TYPE_RANGED) {
+            illegals0 = get_illegal_separations_ranged512(goal_min, goal_max, sorted_octa.zmm0, separations);
+            illegals1 = get_illegal_separations_ranged512(goal_min, goal_max, sorted_octa.zmm1, separations + 4);
+        } else {
+            illegals0 = get_illegal_separations_partial512(sorted_octa.zmm0, separations);
+            illegals1 = get_illegal_separations_partial512(sorted_octa.zmm1, separations + 4);
+        }
+        int legal = octa_empty_lanes(illegals0, illegals1) & octa_valid_lanes(8 * i, count);
+
+        // bits 0-7 for the maps that pass, 8-15 for the ones that would also
+        // pass with covered_threshhold
+        int mask = 0;
+        for (int j = 0; j < 8; j++)
+            mask |= ((separations[j] <= threshhold) | ((separations[j] <= covered_threshhold) << 8)) << j;
+        mask &= legal * 0x101;
+        mask &= (mask << 8) | 255;
+        if (!mask) continue;
+        uint64_t maps[8];
+        _mm512_storeu_si512(maps, octa_pack_map512(octa));
+
+        int extra = ~mask >> 8;
+        for (int j = 7; j >= 0; j--) {
+            current_output->map = maps[j];
+            current_output->separations = separations[j];
+            current_output->index = (i * 8 + j) | (((extra >> j) & 1) * BRANCH_EXTRA);
             current_output += (mask >> j) & 1;
         }
     }
 
-    return current_output - outputs;
+    int count_out = current_output - outputs;
+    for (int i = count_out - 1; i >= 0; i--) {
+        outputs[i].hash = solve_type == HLP_SOLVE_TYPE_EXACT ? cache_hash(outputs[i].map) : get_map_hash(globals, outputs[i].map);
+        cache_prefetch(&main_cache, outputs[i].hash);
+    }
+    return count_out;
+}
+
+#define apply_and_check_inner_wide apply_and_check_inner512
+#else
+#define apply_and_check_inner_wide apply_and_check_inner
+#endif
+
+#define APPLY_AND_CHECK_VARIANT(name, solve_type, inner) \
+static int name(struct hlp_solve_globals* globals, struct precomputed_hex_layer* layer, const uint64_t* luts, \
+        struct hlp_branch* outputs, uint64_t input, int threshhold, int covered_threshhold) { \
+    return inner(globals, layer, luts, outputs, input, threshhold, covered_threshhold, solve_type); \
+}
+
+APPLY_AND_CHECK_VARIANT(apply_and_check_exact, HLP_SOLVE_TYPE_EXACT, apply_and_check_inner_wide)
+APPLY_AND_CHECK_VARIANT(apply_and_check_partial, HLP_SOLVE_TYPE_PARTIAL, apply_and_check_inner_wide)
+APPLY_AND_CHECK_VARIANT(apply_and_check_ranged, HLP_SOLVE_TYPE_RANGED, apply_and_check_inner_wide)
+
+/* apply every next layer to the input, and keep the ones that still pass
+ * the distance check, with the copy of the kernel for the goal's solve type
+ */
+static inline __attribute__((always_inline)) int batch_apply_and_check_exact(
+        struct hlp_solve_globals* globals,
+        struct precomputed_hex_layer* layer,
+        const uint64_t* luts,
+        struct hlp_branch* outputs,
+        uint64_t input,
+        int threshhold,
+        int covered_threshhold) {
+    return globals->config.apply_and_check(globals, layer, luts, outputs, input, threshhold, covered_threshhold);
 }
 
 static int get_min_group(uint64_t mins, uint64_t maxs) {
@@ -240,13 +713,98 @@ static int get_min_group(uint64_t mins, uint64_t maxs) {
     return result;
 }
 
+/* the fewest different values any map within the ranges can have, which is
+ * the fewest values it takes for every range to contain one. going through
+ * the ranges by where they end, a value is only needed at the end of each
+ * one that doesn't contain the last value picked
+ */
+static int get_range_group(uint64_t mins, uint64_t maxs) {
+    int ranges[16][2];
+    int count = 0;
+    for (int i = 0; i < 16; i++) {
+        int min_val = (mins >> i * 4) & 15;
+        int max_val = (maxs >> i * 4) & 15;
+        if (min_val == 0 && max_val == 15) continue;
+        // insertion sort by the end of the range
+        int j = count++;
+        for (; j && ranges[j - 1][1] > max_val; j--) {
+            ranges[j][0] = ranges[j - 1][0];
+            ranges[j][1] = ranges[j - 1][1];
+        }
+        ranges[j][0] = min_val;
+        ranges[j][1] = max_val;
+    }
+
+    int result = 0;
+    int last_value = -1;
+    for (int i = 0; i < count; i++) {
+        if (ranges[i][0] <= last_value) continue;
+        last_value = ranges[i][1];
+        result++;
+    }
+    if (!result) return 1;
+    return result;
+}
+
+static void count_iterations(struct hlp_solve_globals* globals, int depth, long count) {
+    globals->stats.total_iterations += count;
+    globals->stats.depth_iterations[depth] += count;
+}
+
+// count the chain in working_chain, which just reached the goal
+static void record_solution(struct hlp_solve_globals* globals) {
+    globals->output.solutions_found++;
+    if (!globals->output.print_solutions) return;
+    print_chain(globals->output.working_chain, globals->config.current_bfs_depth);
+    printf("\n");
+}
+
+/* the next layer at index reached the goal in a last layer search. returns
+ * 1 if that's the end of the search
+ */
+static int last_layer_found(struct hlp_solve_globals* globals, struct precomputed_hex_layer* layer, int index) {
+    count_iterations(globals, globals->config.current_bfs_depth, -index);
+    uint16_t config = layer->next_layers[index]->config;
+    if (globals->output.solutions_found != -1) {
+        globals->output.working_chain[globals->config.current_bfs_depth - 1] = config;
+        record_solution(globals);
+        return 0;
+    }
+    globals->output.chain_length = globals->config.current_bfs_depth;
+    globals->output.working_chain[globals->config.current_bfs_depth - 1] = config;
+    return 1;
+}
+
+#ifdef USE_AVX512
+// fast_last_layer_search 8 maps at a time, see octa_apply_map512
+static int fast_last_layer_search(struct hlp_solve_globals* globals, uint64_t input, struct precomputed_hex_layer* layer, const uint64_t* luts) {
+    octa_input_t octa_input = octa_prepare_input512(input);
+    __m512i goal_min = QUAD_XMM(_mm256_castsi256_si128(globals->config.goal_min));
+    __m512i goal_max = QUAD_XMM(_mm256_castsi256_si128(globals->config.goal_max));
+    int count = layer->next_layer_count;
+
+    count_iterations(globals, globals->config.current_bfs_depth, count);
+    for (int i = (count - 1) / 8; i >= 0; i--) {
+        zmm_pair_t octa = octa_apply_map512(_mm512_loadu_si512(luts + 8 * i), octa_input);
+        // the same ranged test as below, with a bit for each value out of range
+        __mmask64 misses0 = _mm512_cmplt_epu8_mask(octa.zmm0, goal_min) | _mm512_cmpgt_epu8_mask(octa.zmm0, goal_max);
+        __mmask64 misses1 = _mm512_cmplt_epu8_mask(octa.zmm1, goal_min) | _mm512_cmpgt_epu8_mask(octa.zmm1, goal_max);
+        int successes = octa_empty_lanes(misses0, misses1) & octa_valid_lanes(8 * i, count);
+        if (!successes) continue;
+
+        for (int j = 0; j < 8; j++)
+            if (((successes >> j) & 1) && last_layer_found(globals, layer, i * 8 + j)) return 1;
+    }
+    return 0;
+}
+#else
 //faster implementation of searching over the last layer while checking if you found the goal, unexpectedly big optimization
-static int fast_last_layer_search(struct hlp_solve_globals* globals, uint64_t input, struct precomputed_hex_layer* layer) {
+static int fast_last_layer_search(struct hlp_solve_globals* globals, uint64_t input, struct precomputed_hex_layer* layer, const uint64_t* luts) {
     __m256i doubled_input = _mm256_permute4x64_epi64(_mm256_castsi128_si256(unpack_uint_to_xmm(input)), 0x44);
 
-    __m256i* quad_maps = (__m256i*) (layer->next_layer_luts);
+    __m256i* quad_maps = (__m256i*) luts;
 
-    globals->stats.total_iterations += layer->next_layer_count;
+    count_iterations(globals, globals->config.current_bfs_depth, layer->next_layer_count);
     for (int i = (layer->next_layer_count - 1) / 4; i >= 0; i--) {
         ymm_pair_t quad = quad_unpack_map256(_mm256_loadu_si256(quad_maps + i));
 
@@ -268,36 +826,173 @@ static int fast_last_layer_search(struct hlp_solve_globals* globals, uint64_t in
             _mm256_testc_si256(LO_HALVES_128_256, quad.ymm0),
             _mm256_testc_si256(LO_HALVES_128_256, quad.ymm1)};
 
-        for (int j=0; j<4; j++) {
-            if (!successes[j]) continue;
-            int index = i * 4 + j;
-            globals->stats.total_iterations -= index;
-            uint16_t config = layer->next_layers[index]->config;
-            if (globals->output.solutions_found != -1) {
-                globals->output.solutions_found++;
-                continue;
+        int valid = quad_valid_lanes(i * 4, layer->next_layer_count);
+        for (int j=0; j<4; j++)
+            if (successes[j] && ((valid >> j) & 1) && last_layer_found(globals, layer, i * 4 + j)) return 1;
+    }
+    return 0;
+}
+#endif
+
+static int cmp_leaf_layer(const void* a, const void* b) {
+    uintptr_t layer_a = (uintptr_t) ((struct hlp_leaf*) a)->layer;
+    uintptr_t layer_b = (uintptr_t) ((struct hlp_leaf*) b)->layer;
+    return (layer_a > layer_b) - (layer_a < layer_b);
+}
+
+/* the next layer at index of the leaf's layer reached the goal in a batched
+ * last layer search. returns 1 if that's the end of the search
+ */
+static int leaf_found(struct hlp_solve_globals* globals, struct hlp_leaf* leaf, struct precomputed_hex_layer* layer, int index) {
+    if (globals->output.solutions_found != -1) {
+        globals->output.solutions_found++;
+        return 0;
+    }
+    int depth = globals->config.current_bfs_depth;
+    if (depth >= 3) globals->output.working_chain[depth - 3] = leaf->parent_config;
+    globals->output.working_chain[depth - 2] = leaf->config;
+    globals->output.working_chain[depth - 1] = layer->next_layers[index]->config;
+    globals->output.chain_length = depth;
+    return 1;
+}
+
+#ifdef USE_AVX512
+// batch_last_layer_search 8 maps at a time, see octa_apply_map512
+static int batch_last_layer_search(struct hlp_solve_globals* globals) {
+    struct hlp_leaf* leaves = globals->leaves.queue;
+    int count = globals->leaves.count;
+    qsort(leaves, count, sizeof(struct hlp_leaf), cmp_leaf_layer);
+
+    __m512i goal_min = QUAD_XMM(_mm256_castsi256_si128(globals->config.goal_min));
+    __m512i goal_max = QUAD_XMM(_mm256_castsi256_si128(globals->config.goal_max));
+    octa_input_t octa_inputs[LEAF_BATCH_SIZE];
+    for (int k = 0; k < count; k++)
+        octa_inputs[k] = octa_prepare_input512(leaves[k].map);
+
+    int end;
+    for (int start = 0; start < count; start = end) {
+        struct precomputed_hex_layer* layer = leaves[start].layer;
+        for (end = start + 1; end < count && leaves[end].layer == layer; end++);
+        int layer_count = layer->next_layer_count;
+        count_iterations(globals, globals->config.current_bfs_depth, (long) layer_count * (end - start));
+
+        for (int i = (layer_count - 1) / 8; i >= 0; i--) {
+            __m512i packed = _mm512_loadu_si512(layer->next_layer_luts + 8 * i);
+            int valid = octa_valid_lanes(8 * i, layer_count);
+            for (int k = start; k < end; k++) {
+                zmm_pair_t octa = octa_apply_map512(packed, octa_inputs[k]);
+                __mmask64 misses0 = _mm512_cmplt_epu8_mask(octa.zmm0, goal_min) | _mm512_cmpgt_epu8_mask(octa.zmm0, goal_max);
+                __mmask64 misses1 = _mm512_cmplt_epu8_mask(octa.zmm1, goal_min) | _mm512_cmpgt_epu8_mask(octa.zmm1, goal_max);
+                int successes = octa_empty_lanes(misses0, misses1) & valid;
+                if (!successes) continue;
+
+                for (int j = 0; j < 8; j++)
+                    if (((successes >> j) & 1) && leaf_found(globals, leaves + k, layer, i * 8 + j)) return 1;
             }
-            globals->output.chain_length = globals->config.current_bfs_depth;
-            if (globals->output.chain != 0) globals->output.chain[globals->config.current_bfs_depth - 1] = config;
-            return 1;
         }
     }
     return 0;
 }
+#else
+/* same as fast_last_layer_search, but over every leaf in the queue at once.
+ * leaves that share a layer are searched together, so each quad of its maps
+ * gets loaded and unpacked only once for all of them
+ */
+static int batch_last_layer_search(struct hlp_solve_globals* globals) {
+    struct hlp_leaf* leaves = globals->leaves.queue;
+    int count = globals->leaves.count;
+    qsort(leaves, count, sizeof(struct hlp_leaf), cmp_leaf_layer);
+
+    __m256i goal_min = globals->config.goal_min;
+    __m256i goal_max = globals->config.goal_max;
+    __m256i doubled_inputs[LEAF_BATCH_SIZE];
+    for (int k = 0; k < count; k++)
+        doubled_inputs[k] = _mm256_permute4x64_epi64(_mm256_castsi128_si256(unpack_uint_to_xmm(leaves[k].map)), 0x44);
+
+    int end;
+    for (int start = 0; start < count; start = end) {
+        struct precomputed_hex_layer* layer = leaves[start].layer;
+        for (end = start + 1; end < count && leaves[end].layer == layer; end++);
+        __m256i* quad_maps = (__m256i*) (layer->next_layer_luts);
+        count_iterations(globals, globals->config.current_bfs_depth, (long) layer->next_layer_count * (end - start));
+
+        for (int i = (layer->next_layer_count - 1) / 4; i >= 0; i--) {
+            ymm_pair_t quad = quad_unpack_map256(_mm256_loadu_si256(quad_maps + i));
+            for (int k = start; k < end; k++) {
+                __m256i ymm0 = _mm256_shuffle_epi8(quad.ymm0, doubled_inputs[k]);
+                __m256i ymm1 = _mm256_shuffle_epi8(quad.ymm1, doubled_inputs[k]);
+                ymm0 = _mm256_or_si256(_mm256_cmpgt_epi8(goal_min, ymm0), _mm256_cmpgt_epi8(ymm0, goal_max));
+                ymm1 = _mm256_or_si256(_mm256_cmpgt_epi8(goal_min, ymm1), _mm256_cmpgt_epi8(ymm1, goal_max));
+                if (_mm256_testnzc_si256(LO_HALVES_128_256, ymm0) && _mm256_testnzc_si256(LO_HALVES_128_256, ymm1)) continue;
+
+                bool successes[] = {
+                    _mm256_testz_si256(LO_HALVES_128_256, ymm0),
+                    _mm256_testz_si256(LO_HALVES_128_256, ymm1),
+                    _mm256_testc_si256(LO_HALVES_128_256, ymm0),
+                    _mm256_testc_si256(LO_HALVES_128_256, ymm1)};
+
+                int valid = quad_valid_lanes(i * 4, layer->next_layer_count);
+                for (int j = 0; j < 4; j++)
+                    if (successes[j] && ((valid >> j) & 1) && leaf_found(globals, leaves + k, layer, i * 4 + j)) return 1;
+            }
+        }
+    }
+    return 0;
+}
+#endif
 
 // the most number of separations that can be found in the distance check before it prunes
-static int get_dist_threshold(struct hlp_solve_globals* globals, int remaining_layers) {
-    if (globals->config.accuracy == ACCURACY_REDUCED) return remaining_layers - (remaining_layers > 2);
+static int get_dist_threshold_at(int accuracy, int group, int remaining_layers) {
+    if (accuracy == ACCURACY_REDUCED) return remaining_layers - (remaining_layers > 2);
     // n is always sufficient anyways for 15-16 outputs
-    if (globals->config.accuracy == ACCURACY_NORMAL || globals->config.group > 14) return remaining_layers;
+    if (accuracy == ACCURACY_NORMAL || group > 14) return remaining_layers;
     // n+1 is always sufficient for 14 outputs
-    if (globals->config.accuracy == ACCURACY_INCREASED || globals->config.group > 13) return remaining_layers + 1;
+    if (accuracy == ACCURACY_INCREASED || group > 13) return remaining_layers + 1;
 
     // currently the best known general threshhold
     // +/-1 is for round up division
     return ((remaining_layers * 3 - 1) >> 1) + 1;
 }
 
+static int get_dist_threshold(struct hlp_solve_globals* globals, int remaining_layers) {
+    return get_dist_threshold_at(globals->config.accuracy, globals->config.group, remaining_layers);
+}
+
+/* the fewest layers a map with this many separations could still be from the
+ * goal, going by the thresholds. with ACCURACY_PERFECT this never overshoots
+ */
+static int get_dist_estimate(int accuracy, int group, int separations) {
+    int layers = 0;
+    while (get_dist_threshold_at(accuracy, group, layers) < separations) layers++;
+    return layers;
+}
+
+/* put the branches closest to the goal at the back, where they get searched
+ * first. the separations only go up to 15, so this is a counting sort, using
+ * the space after the branches as scratch
+ */
+static void sort_branches_by_estimate(struct hlp_branch* branches, int count, struct hlp_branch* scratch) {
+    int starts[17] = { 0 };
+    for (int i = 0; i < count; i++) starts[16 - branches[i].separations]++;
+    for (int key = 1; key < 17; key++) starts[key] += starts[key - 1];
+    for (int i = count - 1; i >= 0; i--) scratch[--starts[16 - branches[i].separations]] = branches[i];
+    memcpy(branches, scratch, count * sizeof(struct hlp_branch));
+}
+
+/* how many remaining layers a dead end found at one accuracy still proves at
+ * another. it holds as long as the new thresholds prune at least as much at
+ * every layer below it, and the last layer is never pruned at all
+ */
+static int get_carry_limit(struct hlp_solve_globals* globals, int from_accuracy, int to_accuracy) {
+    // the finish index doesn't prune at all
+    int limit = globals->config.finish_layers > 1 ? globals->config.finish_layers : 1;
+    while (limit < 31 &&
+            get_dist_threshold_at(to_accuracy, globals->config.group, limit) <=
+            get_dist_threshold_at(from_accuracy, globals->config.group, limit))
+        limit++;
+    return limit;
+}
+
 /* test to see if this map falls under a solution
  */
 static int test_map(struct hlp_solve_globals* globals, uint64_t map) {
@@ -309,54 +1004,686 @@ static int test_map(struct hlp_solve_globals* globals, uint64_t map) {
 }
 
 
-//main dfs recursive search function
-static int dfs(struct hlp_solve_globals* globals, uint64_t input, int depth, struct precomputed_hex_layer* layer, uint16_t* staged_branches) {
-    // test to see if we found a solution, even if we're not at the end. this
-    // can happen even though it seems like it shouldn't
-    if (test_map(globals, input)) {
-        globals->output.chain_length = depth;
+static int should_split(struct hlp_solve_globals* globals, int depth) {
+    if (!globals->parallel.search) return 0;
+    if (depth <= PARALLEL_SPLIT_DEPTH) return 1;
+    if (globals->config.current_bfs_depth - depth < PARALLEL_MIN_SPLIT_REMAINING) return 0;
+    return work_pool_hungry(globals->parallel.search->pool);
+}
+
+static double get_wall_time() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// only looks at the clock every so often, but stays timed out once it is
+static int past_deadline(struct hlp_solve_globals* globals) {
+    if (globals->stats.timed_out) return 1;
+    if (--globals->stats.deadline_countdown > 0) return 0;
+    globals->stats.deadline_countdown = DEADLINE_CHECK_INTERVAL;
+    if (get_wall_time() < globals->config.deadline) return 0;
+    globals->stats.timed_out = 1;
+    // stop every other worker too
+    if (globals->parallel.search) work_pool_cancel(globals->parallel.search->pool);
+    return 1;
+}
+
+// the search was cut short, so whatever it didn't find proves nothing
+static int search_aborted(struct hlp_solve_globals* globals) {
+    if (globals->config.deadline && past_deadline(globals)) return 1;
+    return globals->parallel.search && work_pool_cancelled(globals->parallel.search->pool);
+}
+
+static void push_task(struct hlp_solve_globals* globals, uint64_t map, int depth, int path, struct precomputed_hex_layer* layer) {
+    struct hlp_task task = { map, layer, depth, path };
+    memcpy(task.chain, globals->output.working_chain, depth * sizeof(uint16_t));
+    globals->parallel.split_count++;
+    work_pool_push(globals->parallel.search->pool, globals->parallel.worker_id, &task);
+}
+
+// try to finish the chain from here with the finish index
+static int finish_search(struct hlp_solve_globals* globals, uint64_t input, int depth) {
+    // counted as the first of the layers it stands in for
+    count_iterations(globals, depth + 1, 1);
+    int length = hlp_finish_lookup(
+            globals->config.finish_index,
+            input,
+            globals->config.finish_goal_min,
+            globals->config.finish_goal_max,
+            globals->config.current_bfs_depth - depth,
+            globals->output.working_chain + depth);
+    if (!length) return 0;
+    globals->output.chain_length = depth + length;
+    return 1;
+}
+
+static int get_root_path(struct hlp_solve_globals* globals) {
+    int path = 0;
+    if (globals->config.current_bfs_depth <= globals->config.covered_depth) path |= PATH_COVERED;
+    if (globals->config.presearch_length) path |= PATH_ON_PRESEARCH_CHAIN;
+    return path;
+}
+
+// move the branch the presearch took from here to the front of the line
+static void stage_presearch_branch(struct hlp_solve_globals* globals, struct precomputed_hex_layer* layer, struct hlp_branch* staged_branches, int count, int depth) {
+    uint16_t config = globals->config.presearch_chain[depth];
+    for (int i = 0; i < count; i++) {
+        if (layer->next_layers[staged_branches[i].index & BRANCH_INDEX_MASK]->config != config) continue;
+        // branches are searched from the back
+        struct hlp_branch branch = staged_branches[i];
+        staged_branches[i] = staged_branches[count - 1];
+        staged_branches[count - 1] = branch;
+        return;
+    }
+}
+
+static void reset_leaves(struct hlp_solve_globals* globals) {
+    globals->leaves.count = 0;
+    globals->leaves.pending_count = 0;
+    memset(globals->leaves.waiting, 0, sizeof(globals->leaves.waiting));
+}
+
+/* search everything in the leaf queue, then record the leaves and every
+ * parent that was waiting on them as dead ends
+ */
+static int flush_leaves(struct hlp_solve_globals* globals) {
+    struct __leaves__* leaves = &globals->leaves;
+    globals->stats.leaf_batches += leaves->count > 0;
+    int found = leaves->count && batch_last_layer_search(globals);
+    if (!found && !search_aborted(globals)) {
+        for (int i = 0; i < leaves->count; i++)
+            cache_store_hashed(&main_cache, globals->cache_stats, leaves->queue[i].hash, 1);
+        for (int i = 0; i < leaves->pending_count; i++)
+            cache_store_hashed(&main_cache, globals->cache_stats, leaves->pending_parents[i], 2);
+    }
+    reset_leaves(globals);
+    return found;
+}
+
+// the slot for a hash, which is blank if it isn't waiting on the leaf queue
+static struct __waiting__* find_waiting(struct hlp_solve_globals* globals, uint64_t hash) {
+    struct __waiting__* waiting = globals->leaves.waiting;
+    for (uint64_t i = hash >> 32;; i++) {
+        struct __waiting__* slot = waiting + (i & (LEAF_WAITING_SLOTS - 1));
+        if (!slot->remaining || slot->hash == hash) return slot;
+    }
+}
+
+static void mark_waiting(struct hlp_solve_globals* globals, uint64_t hash, int remaining) {
+    struct __waiting__* slot = find_waiting(globals, hash);
+    slot->hash = hash;
+    if (slot->remaining < remaining) slot->remaining = remaining;
+}
+
+// hand a child one layer from the end over to the leaf queue
+static int queue_leaf(struct hlp_solve_globals* globals, struct hlp_branch* branch, int path, struct precomputed_hex_layer* layer, int depth) {
+    if (test_map(globals, branch->map)) {
+        globals->output.chain_length = depth + 1;
         return 1;
     }
+    if ((path & PATH_COVERED) && globals->config.covered_limit >= 1) {
+        cache_store_hashed(&main_cache, globals->cache_stats, branch->hash, 1);
+        return 0;
+    }
+    // a transposition of a leaf that's already waiting
+    if (find_waiting(globals, branch->hash)->remaining) return 0;
+    mark_waiting(globals, branch->hash, 1);
+
+    struct __leaves__* leaves = &globals->leaves;
+    struct hlp_leaf* leaf = leaves->queue + leaves->count++;
+    leaf->map = branch->map;
+    leaf->hash = branch->hash;
+    leaf->layer = layer;
+    leaf->parent_config = depth ? globals->output.working_chain[depth - 1] : 0;
+    leaf->config = layer->config;
+    if (leaves->count < LEAF_BATCH_SIZE) return 0;
+    return flush_leaves(globals);
+}
 
-    if(depth == globals->config.current_bfs_depth - 1) return fast_last_layer_search(globals, input, layer);
-    globals->stats.total_iterations += layer->next_layer_count;
-    int total_next_layers_identified = batch_apply_and_check_exact(
+// a parent whose leaves may still be in the queue gets stored once they're done
+static int defer_parent_store(struct hlp_solve_globals* globals, uint64_t hash) {
+    struct __leaves__* leaves = &globals->leaves;
+    mark_waiting(globals, hash, 2);
+    leaves->pending_parents[leaves->pending_count++] = hash;
+    if (leaves->pending_count < LEAF_BATCH_SIZE) return 0;
+    return flush_leaves(globals);
+}
+
+/* stage every child of the node at depth that passes the checks, in the
+ * order they should be searched from the back. given the layer's pair_luts,
+ * those are its grandchildren through each of its next layers instead
+ */
+static int expand_branches(struct hlp_solve_globals* globals, struct precomputed_hex_layer* layer, const uint64_t* luts, struct hlp_branch* staged_branches, uint64_t input, int depth, int path) {
+    int remaining = globals->config.current_bfs_depth - depth - 1;
+    int threshold = get_dist_threshold(globals, remaining);
+    int covered_threshold = threshold;
+    if (path & PATH_COVERED)
+        covered_threshold = get_dist_threshold_at(globals->config.covered_accuracy, globals->config.group, remaining);
+
+    count_iterations(globals, depth + 1, layer->next_layer_count);
+    int count = batch_apply_and_check_exact(
             globals,
             layer,
+            luts,
             staged_branches,
             input,
-            get_dist_threshold(globals, globals->config.current_bfs_depth - depth - 1));
+            threshold,
+            covered_threshold);
+
+    // every pass of the presearch but the last comes up empty, and the last
+    // one stops at the first solution, so getting to it sooner pays for the
+    // sort. the main search mostly runs to the end anyways
+    if (globals->config.engine == HLP_ENGINE_IDA || globals->config.accuracy == ACCURACY_REDUCED)
+        sort_branches_by_estimate(staged_branches, count, staged_branches + layer->next_layer_count);
+
+    if ((path & PATH_ON_PRESEARCH_CHAIN) && depth < globals->config.presearch_length)
+        stage_presearch_branch(globals, layer, staged_branches, count, depth);
+    return count;
+}
+
+// the path a staged branch out of the node at depth is on
+static int get_branch_path(struct hlp_solve_globals* globals, struct hlp_branch* branch, struct precomputed_hex_layer* next_layer, int depth, int path) {
+    if (branch->index & BRANCH_EXTRA) path &= ~PATH_COVERED;
+    if (next_layer->config != globals->config.presearch_chain[depth]) path &= ~PATH_ON_PRESEARCH_CHAIN;
+    return path;
+}
+
+static int dfs(struct hlp_solve_globals* globals, uint64_t input, int depth, int path, struct precomputed_hex_layer* layer, struct hlp_branch* staged_branches);
+
+/* search the next two layers from a node in one call. the children still get
+ * every check dfs would give them, but instead of a call of their own, their
+ * children come straight out of input through the pair luts. right before the
+ * end, that makes the last two layers one sweep over the pair luts per child
+ */
+static int macro_step(struct hlp_solve_globals* globals, uint64_t input, int depth, int path, struct precomputed_hex_layer* layer, struct hlp_branch* staged_branches) {
+    int remaining = globals->config.current_bfs_depth - depth - 1;
+    int child_count = expand_branches(globals, layer, layer->next_layer_luts, staged_branches, input, depth, path);
+    struct hlp_branch* grandchildren = staged_branches + layer->next_layer_count;
+
+    for (int i = child_count - 1; i >= 0; i--) {
+        if (search_aborted(globals)) return 0;
+        struct hlp_branch* child = staged_branches + i;
+        struct precomputed_hex_layer* child_layer = layer->next_layers[child->index & BRANCH_INDEX_MASK];
+        int child_path = get_branch_path(globals, child, child_layer, depth, path);
+
+        if (globals->config.use_pdb && hlp_pdb_bound(&globals->config.pdb, child->map) > remaining) continue;
+        if (cache_check_hashed(&main_cache, globals->cache_stats, child->hash, remaining)) continue;
+        globals->output.working_chain[depth] = child_layer->config;
+
+        // what dfs would have checked on the way into the child
+        if (globals->output.solutions_found == -1 && test_map(globals, child->map)) {
+            globals->output.chain_length = depth + 1;
+            return 1;
+        }
+        if ((child_path & PATH_COVERED) && remaining <= globals->config.covered_limit) {
+            cache_store_hashed(&main_cache, globals->cache_stats, child->hash, remaining);
+            continue;
+        }
+        if (remaining <= globals->config.finish_layers) {
+            if (finish_search(globals, child->map, depth + 1)) return 1;
+            cache_store_hashed(&main_cache, globals->cache_stats, child->hash, remaining);
+            continue;
+        }
+        if (should_split(globals, depth + 1)) {
+            push_task(globals, child->map, depth + 1, child_path, child_layer);
+            continue;
+        }
+
+        long solutions_found = globals->output.solutions_found;
+        long split_count = globals->parallel.split_count;
+        if (remaining == 1) {
+            if (fast_last_layer_search(globals, input, child_layer, child_layer->pair_luts)) return 1;
+        } else {
+            int grandchild_count = expand_branches(globals, child_layer, child_layer->pair_luts, grandchildren, input, depth + 1, child_path);
+            for (int j = grandchild_count - 1; j >= 0; j--) {
+                if (search_aborted(globals)) return 0;
+                struct hlp_branch* grandchild = grandchildren + j;
+                struct precomputed_hex_layer* next_layer = child_layer->next_layers[grandchild->index & BRANCH_INDEX_MASK];
+                int next_path = get_branch_path(globals, grandchild, next_layer, depth + 1, child_path);
+
+                if (globals->config.use_pdb && hlp_pdb_bound(&globals->config.pdb, grandchild->map) > remaining - 1) continue;
+                if (cache_check_hashed(&main_cache, globals->cache_stats, grandchild->hash, remaining - 1)) continue;
+                globals->output.working_chain[depth + 1] = next_layer->config;
+
+                if (should_split(globals, depth + 2)) {
+                    push_task(globals, grandchild->map, depth + 2, next_path, next_layer);
+                    continue;
+                }
+                long grandchild_solutions_found = globals->output.solutions_found;
+                long grandchild_split_count = globals->parallel.split_count;
+                if (dfs(globals, grandchild->map, depth + 2, next_path, next_layer, grandchildren + child_layer->next_layer_count)) return 1;
+                if (search_aborted(globals)) return 0;
+                if (globals->output.solutions_found != grandchild_solutions_found) continue;
+                if (globals->parallel.split_count != grandchild_split_count) continue;
+                cache_store_hashed(&main_cache, globals->cache_stats, grandchild->hash, remaining - 1);
+            }
+        }
+        if (search_aborted(globals)) return 0;
+        if (globals->output.solutions_found != solutions_found) continue;
+        if (globals->parallel.split_count != split_count) continue;
+        cache_store_hashed(&main_cache, globals->cache_stats, child->hash, remaining);
+    }
+    return 0;
+}
+
+//main dfs recursive search function
+static int dfs(struct hlp_solve_globals* globals, uint64_t input, int depth, int path, struct precomputed_hex_layer* layer, struct hlp_branch* staged_branches) {
+    // test to see if we found a solution, even if we're not at the end. this
+    // can happen even though it seems like it shouldn't. when going through
+    // every solution, only the ones of the full length count
+    if (globals->output.solutions_found == -1 && test_map(globals, input)) {
+        globals->output.chain_length = depth;
+        return 1;
+    }
+
+    // the presearch already went through everything under here
+    if ((path & PATH_COVERED) && globals->config.current_bfs_depth - depth <= globals->config.covered_limit) return 0;
+
+    if (globals->config.current_bfs_depth - depth <= globals->config.finish_layers) return finish_search(globals, input, depth);
+    if(depth == globals->config.current_bfs_depth - 1) return fast_last_layer_search(globals, input, layer, layer->next_layer_luts);
+    int remaining = globals->config.current_bfs_depth - depth - 1;
+    if (globals->config.macro_step) return macro_step(globals, input, depth, path, layer, staged_branches);
+
+    // with the finish index there are no leaves to batch up, and leaves
+    // don't keep the whole chain to print every solution
+    int batch_leaves = !globals->config.finish_layers && globals->output.solutions_found == -1;
+
+    int total_next_layers_identified = expand_branches(globals, layer, layer->next_layer_luts, staged_branches, input, depth, path);
 
     for(int i = total_next_layers_identified - 1; i >= 0; i--) {
-        struct precomputed_hex_layer* next_layer = layer->next_layers[staged_branches[i]];
-        uint64_t output = apply_mapping_packed64(input, next_layer->map);
+        if (search_aborted(globals)) return 0;
+        struct hlp_branch* branch = staged_branches + i;
+        struct precomputed_hex_layer* next_layer = layer->next_layers[branch->index & BRANCH_INDEX_MASK];
+        uint64_t output = branch->map;
+        int next_path = get_branch_path(globals, branch, next_layer, depth, path);
+
+        if (globals->config.use_pdb && hlp_pdb_bound(&globals->config.pdb, output) > remaining) continue;
 
         //cache check
-        if(cache_check(&main_cache, output, depth)) continue;
+        if(cache_check_hashed(&main_cache, globals->cache_stats, branch->hash, remaining)) continue;
+        if (batch_leaves && remaining == 2 && find_waiting(globals, branch->hash)->remaining == 2) continue;
+
+        // the chain is filled in on the way down so that it can be handed
+        // off along with any task that gets split off
+        globals->output.working_chain[depth] = next_layer->config;
+
+        // the last layer gets searched in bulk across siblings
+        if (batch_leaves && remaining == 1) {
+            if (queue_leaf(globals, branch, next_path, next_layer, depth)) return 1;
+            continue;
+        }
+
+        if (should_split(globals, depth + 1)) {
+            push_task(globals, output, depth + 1, next_path, next_layer);
+            continue;
+        }
 
         //call next layers
-        if(dfs(globals, output, depth + 1, next_layer, staged_branches + layer->next_layer_count)) {
-            if (globals->output.chain != 0) globals->output.chain[depth] = next_layer->config;
-            return 1;
+        long solutions_found = globals->output.solutions_found;
+        long split_count = globals->parallel.split_count;
+        if(dfs(globals, output, depth + 1, next_path, next_layer, staged_branches + layer->next_layer_count)) return 1;
+        if (search_aborted(globals)) return 0;
+        // it has to be searched again whenever it comes up again
+        if (globals->output.solutions_found != solutions_found) continue;
+        // the tasks split off from under it might not have run yet
+        if (globals->parallel.split_count != split_count) continue;
+        if (batch_leaves && remaining == 2) {
+            if (defer_parent_store(globals, branch->hash)) return 1;
+        } else {
+            cache_store_hashed(&main_cache, globals->cache_stats, branch->hash, remaining);
         }
         if (verbosity < 3) continue;
         if(depth == 0 && globals->config.current_bfs_depth > 8) printf("done:%d/%d\n", total_next_layers_identified - i, total_next_layers_identified);
     }
+
+    // nothing under here is done until the leaves it queued up are
+    if (batch_leaves && (remaining == 2 || depth == 0)) return flush_leaves(globals);
     return 0;
 }
 
-static int init(struct hlp_solve_globals* globals, struct hlp_request request) {
-    cache_init(&main_cache);
-    globals->stats.start_time = clock();
+static void run_task(void* task_ptr, int worker_id, void* context) {
+    struct hlp_task* task = task_ptr;
+    struct hlp_parallel_search* search = context;
+    struct hlp_solve_globals* globals = search->workers + worker_id;
+
+    memcpy(globals->output.working_chain, task->chain, task->depth * sizeof(uint16_t));
+    // anything left from a search that got cut short
+    reset_leaves(globals);
+    long split_count = globals->parallel.split_count;
+    if (!dfs(globals, task->map, task->depth, task->path, task->layer, globals->parallel.staged_branches)) {
+        if (task->depth && !search_aborted(globals) && globals->parallel.split_count == split_count)
+            cache_store_hashed(&main_cache, globals->cache_stats, get_map_hash(globals, task->map), globals->config.current_bfs_depth - task->depth);
+        return;
+    }
+
+    // only the first solution counts, everyone else gets told to stop
+    int expected = 0;
+    if (!atomic_compare_exchange_strong(&search->found, &expected, 1)) return;
+    search->chain_length = globals->output.chain_length;
+    memcpy(search->chain, globals->output.working_chain, search->chain_length * sizeof(uint16_t));
+    work_pool_cancel(search->pool);
+}
+
+static struct hlp_parallel_search* parallel_search_new(struct hlp_solve_globals* globals, struct precomputed_hex_layer* base_layer, int thread_count) {
+    struct hlp_parallel_search* search = malloc(sizeof(struct hlp_parallel_search));
+    search->thread_count = thread_count;
+    search->pool = NULL;
+    search->workers = aligned_alloc(32, thread_count * sizeof(struct hlp_solve_globals));
+
+    for (int i = 0; i < thread_count; i++) {
+        struct hlp_solve_globals* worker = search->workers + i;
+        *worker = *globals;
+        memset(&worker->stats, 0, sizeof(worker->stats));
+        worker->parallel.search = search;
+        worker->parallel.worker_id = i;
+        worker->parallel.staged_branches = malloc(base_layer->next_layer_count * 32 * sizeof(struct hlp_branch));
+        worker->cache_stats = cache_stats_shard(&main_cache, i);
+    }
+    return search;
+}
+
+static void parallel_search_free(struct hlp_parallel_search* search) {
+    if (!search) return;
+    for (int i = 0; i < search->thread_count; i++) {
+        struct hlp_solve_globals* worker = search->workers + i;
+        free(worker->parallel.staged_branches);
+    }
+    free(search->workers);
+    free(search);
+}
+
+// search the current depth with every thread
+static int parallel_dfs(struct hlp_solve_globals* globals, struct precomputed_hex_layer* base_layer) {
+    struct hlp_parallel_search* search = globals->parallel.search;
+    search->pool = work_pool_new(search->thread_count, sizeof(struct hlp_task), run_task, search);
+    atomic_store(&search->found, 0);
+
+    for (int i = 0; i < search->thread_count; i++)
+        search->workers[i].config = globals->config;
+
+    struct hlp_task root = { IDENTITY_PERM_PK64, base_layer, 0, get_root_path(globals) };
+    work_pool_push(search->pool, 0, &root);
+    work_pool_run(search->pool);
+    work_pool_free(search->pool);
+    search->pool = NULL;
+
+    for (int i = 0; i < search->thread_count; i++) {
+        struct hlp_solve_globals* worker = search->workers + i;
+        globals->stats.total_iterations += worker->stats.total_iterations;
+        globals->stats.leaf_batches += worker->stats.leaf_batches;
+        globals->stats.timed_out |= worker->stats.timed_out;
+        worker->stats.timed_out = 0;
+        for (int depth = 0; depth < 32; depth++)
+            globals->stats.depth_iterations[depth] += worker->stats.depth_iterations[depth];
+        memset(worker->stats.depth_iterations, 0, sizeof(worker->stats.depth_iterations));
+        worker->stats.total_iterations = 0;
+        worker->stats.leaf_batches = 0;
+    }
+
+    if (!atomic_load(&search->found)) return 0;
+    globals->output.chain_length = search->chain_length;
+    memcpy(globals->output.working_chain, search->chain, search->chain_length * sizeof(uint16_t));
+    return 1;
+}
+
+static struct hlp_compact_layers* compact_layer_history[16] = { 0 };
+
+// the layers for a group as value tables, building them on first use
+static const struct hlp_compact_layers* get_compact_layers(int group) {
+    if (compact_layer_history[group - 1]) return compact_layer_history[group - 1];
+
+    // the layers out of the identity are every layer that keeps enough
+    // values around, and any other one would lose some for good
+    struct precomputed_hex_layer* identity_layer = precompute_hex_layers(group, 1);
+    int layer_count = identity_layer->next_layer_count;
+    if (!layer_count) return NULL;
+    struct hlp_compact_layers* layers = malloc(sizeof(struct hlp_compact_layers));
+    layers->layer_count = layer_count;
+    layers->padded_count = (layer_count + 7) & ~7;
+    layers->configs = malloc(layers->padded_count * sizeof(uint16_t));
+    layers->columns = aligned_alloc(32, 16 * layers->padded_count);
+    for (int i = 0; i < layers->padded_count; i++) {
+        struct precomputed_hex_layer* layer = identity_layer->next_layers[i < layer_count ? i : layer_count - 1];
+        layers->configs[i] = layer->config;
+        for (int value = 0; value < 16; value++)
+            layers->columns[value * layers->padded_count + i] = (layer->map >> (value < 8 ? 8 * value + 4 : 8 * (value - 8))) & 15;
+    }
+    compact_layer_history[group - 1] = layers;
+    return layers;
+}
+
+/* set up the goal for the compact engine, which only takes goals with exact
+ * values for up to COMPACT_WIDTH outputs, searched the plain way. the other
+ * outputs never affect these, since layers act on each value on its own
+ * returns 1 if the goal doesn't fit
+ */
+static int init_compact(struct hlp_solve_globals* globals) {
+    if (globals->config.solve_type == HLP_SOLVE_TYPE_RANGED) return 1;
+    if (16 - globals->config.dont_care_count > COMPACT_WIDTH) return 1;
+    // everything else goes through the full layers
+    if (global_thread_count > 1 || global_use_pdb || global_macro_step) return 1;
+    if (global_solutions != HLP_SOLUTIONS_FIRST) return 1;
+
+    const uint8_t* goal = globals->config.finish_goal_min;
+    uint8_t* inputs = globals->config.compact_inputs;
+    int count = 0;
+    for (int x = 0; x < 16; x++)
+        if (goal[x] == globals->config.finish_goal_max[x]) inputs[count++] = x;
+    if (!count) return 1;
+    for (int j = count; j < COMPACT_WIDTH; j++) inputs[j] = inputs[count - 1];
+
+    globals->config.compact_start = 0;
+    globals->config.compact_goal = 0;
+    for (int j = 0; j < COMPACT_WIDTH; j++) {
+        globals->config.compact_start |= (uint32_t) inputs[j] << 4 * j;
+        globals->config.compact_goal |= (uint32_t) goal[inputs[j]] << 4 * j;
+    }
+    globals->config.compact_layers = get_compact_layers(globals->config.group);
+    if (!globals->config.compact_layers) return 1;
+    if (verbosity >= 3) printf("compact engine over %d outputs\n", count);
+    return 0;
+}
+
+// the children of a key from a block of 8 layers, one per 32 bit lane
+static __m256i compact_apply(const struct hlp_compact_layers* layers, uint32_t input, int block, __m256i* values) {
+    __m256i keys = _mm256_setzero_si256();
+    for (int j = 0; j < COMPACT_WIDTH; j++) {
+        const uint8_t* column = layers->columns + ((input >> 4 * j) & 15) * layers->padded_count + block * 8;
+        values[j] = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) column));
+        keys = _mm256_or_si256(keys, _mm256_slli_epi32(values[j], 4 * j));
+    }
+    return keys;
+}
+
+// the lanes of the block that are actual layers
+static int compact_block_mask(const struct hlp_compact_layers* layers, int block) {
+    int left = layers->layer_count - block * 8;
+    return left >= 8 ? 0xff : (1 << left) - 1;
+}
+
+#define COMPACT_SORT_PAIR(a, b) {\
+    __m256i low = _mm256_min_epi32(sorted[a], sorted[b]);\
+    sorted[b] = _mm256_max_epi32(sorted[a], sorted[b]);\
+    sorted[a] = low;\
+}
+
+/* the same check as batch_apply_and_check_exact, on a block of children.
+ * each output gets its goal value in the low nibble, and they get sorted by
+ * the output with a sorting network, all 8 children at once. repeated
+ * outputs end up next to the one they repeat, so they never count.
+ * bits 0-7 are set for the children that pass, 8-15 for the ones that
+ * would also pass with covered_threshold
+ */
+static int compact_apply_and_check(
+        struct hlp_solve_globals* globals,
+        uint32_t input,
+        int block,
+        int threshold,
+        int covered_threshold,
+        uint32_t* keys,
+        uint8_t* separations) {
+    __m256i values[COMPACT_WIDTH];
+    __m256i children = compact_apply(globals->config.compact_layers, input, block, values);
+
+    __m256i sorted[COMPACT_WIDTH];
+    for (int j = 0; j < COMPACT_WIDTH; j++)
+        sorted[j] = _mm256_or_si256(_mm256_slli_epi32(values[j], 4), _mm256_set1_epi32((globals->config.compact_goal >> 4 * j) & 15));
+    COMPACT_SORT_PAIR(0, 2); COMPACT_SORT_PAIR(1, 3); COMPACT_SORT_PAIR(4, 6); COMPACT_SORT_PAIR(5, 7);
+    COMPACT_SORT_PAIR(0, 4); COMPACT_SORT_PAIR(1, 5); COMPACT_SORT_PAIR(2, 6); COMPACT_SORT_PAIR(3, 7);
+    COMPACT_SORT_PAIR(0, 1); COMPACT_SORT_PAIR(2, 3); COMPACT_SORT_PAIR(4, 5); COMPACT_SORT_PAIR(6, 7);
+    COMPACT_SORT_PAIR(2, 4); COMPACT_SORT_PAIR(3, 5);
+    COMPACT_SORT_PAIR(1, 4); COMPACT_SORT_PAIR(3, 6);
+    COMPACT_SORT_PAIR(1, 2); COMPACT_SORT_PAIR(3, 4); COMPACT_SORT_PAIR(5, 6);
+
+    // a layer that doesn't change anything here can't lead anywhere new
+    __m256i illegal = _mm256_cmpeq_epi32(children, _mm256_set1_epi32(input));
+    __m256i missing = _mm256_setzero_si256();
+    __m256i low_nibbles = _mm256_set1_epi32(15);
+    for (int j = 0; j < COMPACT_WIDTH - 1; j++) {
+        __m256i final_delta = _mm256_abs_epi32(_mm256_sub_epi32(
+                    _mm256_and_si256(sorted[j + 1], low_nibbles),
+                    _mm256_and_si256(sorted[j], low_nibbles)));
+        __m256i current_delta = _mm256_sub_epi32(_mm256_srli_epi32(sorted[j + 1], 4), _mm256_srli_epi32(sorted[j], 4));
+        __m256i short_of = _mm256_cmpgt_epi32(final_delta, current_delta);
+        // values that got merged can't be split apart again
+        illegal = _mm256_or_si256(illegal, _mm256_and_si256(short_of, _mm256_cmpeq_epi32(current_delta, _mm256_setzero_si256())));
+        missing = _mm256_sub_epi32(missing, short_of);
+    }
+
+    _mm256_storeu_si256((__m256i*) keys, children);
+    __m128i counts = _mm_packus_epi32(_mm256_castsi256_si128(missing), _mm256_extracti128_si256(missing, 1));
+    _mm_storel_epi64((__m128i*) separations, _mm_packus_epi16(counts, counts));
+
+    int legal = ~_mm256_movemask_ps(_mm256_castsi256_ps(illegal)) & compact_block_mask(globals->config.compact_layers, block);
+    int passed = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(missing, _mm256_set1_epi32(threshold)))) & legal;
+    int covered = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(missing, _mm256_set1_epi32(covered_threshold)))) & passed;
+    return passed | (covered << 8);
+}
+
+// the same as fast_last_layer_search, where the goal is a single key
+static int compact_last_layer_search(struct hlp_solve_globals* globals, uint32_t input) {
+    const struct hlp_compact_layers* layers = globals->config.compact_layers;
+    __m256i goal = _mm256_set1_epi32(globals->config.compact_goal);
+    __m256i values[COMPACT_WIDTH];
+    count_iterations(globals, globals->config.current_bfs_depth, layers->layer_count);
+    for (int block = 0; block < layers->padded_count / 8; block++) {
+        __m256i children = compact_apply(layers, input, block, values);
+        int found = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(children, goal)));
+        if (!found) continue;
+        globals->output.chain_length = globals->config.current_bfs_depth;
+        globals->output.working_chain[globals->config.current_bfs_depth - 1] = layers->configs[block * 8 + __builtin_ctz(found)];
+        return 1;
+    }
+    return 0;
+}
+
+// whether a child with this key already came up for the node being expanded
+static int compact_seen(struct hlp_compact_search* search, uint32_t key) {
+    uint32_t slot = (key * 0x9e3779b1u) >> (32 - COMPACT_DEDUP_BITS);
+    while (search->dedup_stamps[slot] == search->stamp) {
+        if (search->dedup_keys[slot] == key) return 1;
+        slot = (slot + 1) & (COMPACT_DEDUP_SLOTS - 1);
+    }
+    search->dedup_stamps[slot] = search->stamp;
+    search->dedup_keys[slot] = key;
+    return 0;
+}
+
+// the same as sort_branches_by_estimate
+static void sort_compact_branches(struct hlp_compact_branch* branches, int count, struct hlp_compact_branch* scratch) {
+    int starts[17] = { 0 };
+    for (int i = 0; i < count; i++) starts[16 - branches[i].separations]++;
+    for (int key = 1; key < 17; key++) starts[key] += starts[key - 1];
+    for (int i = count - 1; i >= 0; i--) scratch[--starts[16 - branches[i].separations]] = branches[i];
+    memcpy(branches, scratch, count * sizeof(struct hlp_compact_branch));
+}
+
+/* the same as dfs, but on maps cut down to the outputs the goal cares
+ * about. on top of being cheaper to check, that makes a lot more layers do
+ * the same thing, so children are deduplicated by key, and the cache holds
+ * keys instead of whole maps. everything else goes the same as dfs without
+ * any of the extras, including the presearch and covered paths
+ */
+static int compact_dfs(struct hlp_solve_globals* globals, struct hlp_compact_search* search, uint32_t input, int depth, int path, struct hlp_compact_branch* staged_branches) {
+    if (input == globals->config.compact_goal) {
+        globals->output.chain_length = depth;
+        return 1;
+    }
+    if ((path & PATH_COVERED) && globals->config.current_bfs_depth - depth <= globals->config.covered_limit) return 0;
+    if (depth == globals->config.current_bfs_depth - 1) return compact_last_layer_search(globals, input);
+
+    const struct hlp_compact_layers* layers = globals->config.compact_layers;
+    int remaining = globals->config.current_bfs_depth - depth - 1;
+    int threshold = get_dist_threshold(globals, remaining);
+    int covered_threshold = threshold;
+    if (path & PATH_COVERED)
+        covered_threshold = get_dist_threshold_at(globals->config.covered_accuracy, globals->config.group, remaining);
+    count_iterations(globals, depth + 1, layers->layer_count);
+
+    if (!++search->stamp) {
+        memset(search->dedup_stamps, 0, sizeof(search->dedup_stamps));
+        search->stamp = 1;
+    }
+    int count = 0;
+    for (int block = 0; block < layers->padded_count / 8; block++) {
+        uint32_t keys[8];
+        uint8_t separations[8];
+        int mask = compact_apply_and_check(globals, input, block, threshold, covered_threshold, keys, separations);
+        for (int passed = mask & 0xff; passed; passed &= passed - 1) {
+            int j = __builtin_ctz(passed);
+            if (compact_seen(search, keys[j])) continue;
+            struct hlp_compact_branch* branch = staged_branches + count++;
+            branch->key = keys[j];
+            branch->separations = separations[j];
+            branch->index = (block * 8 + j) | ((mask >> (8 + j) & 1) ? 0 : BRANCH_EXTRA);
+            branch->hash = cache_hash(keys[j]);
+            cache_prefetch(&main_cache, branch->hash);
+        }
+    }
+    if (globals->config.accuracy == ACCURACY_REDUCED)
+        sort_compact_branches(staged_branches, count, staged_branches + layers->layer_count);
+
+    for (int i = count - 1; i >= 0; i--) {
+        if (search_aborted(globals)) return 0;
+        struct hlp_compact_branch* branch = staged_branches + i;
+        if (cache_check_hashed(&main_cache, globals->cache_stats, branch->hash, remaining)) continue;
+
+        int next_path = branch->index & BRANCH_EXTRA ? 0 : path & PATH_COVERED;
+        globals->output.working_chain[depth] = layers->configs[branch->index & BRANCH_INDEX_MASK];
+        if (compact_dfs(globals, search, branch->key, depth + 1, next_path, staged_branches + layers->layer_count)) return 1;
+        if (search_aborted(globals)) return 0;
+        cache_store_hashed(&main_cache, globals->cache_stats, branch->hash, remaining);
+    }
+    return 0;
+}
+
+// search_depth for the compact engine
+static int compact_search_depth(struct hlp_solve_globals* globals) {
+    struct hlp_compact_search* search = calloc(1, sizeof(struct hlp_compact_search));
+    struct hlp_compact_branch* staged_branches = malloc(globals->config.compact_layers->layer_count * globals->config.current_bfs_depth * sizeof(struct hlp_compact_branch));
+    int success = compact_dfs(globals, search, globals->config.compact_start, 0, get_root_path(globals) & PATH_COVERED, staged_branches);
+    free(staged_branches);
+    free(search);
+    return success;
+}
+
+// everything in the config that comes from the goal itself
+static int init_goal(struct hlp_solve_globals* globals, struct hlp_request request) {
     globals->config.solve_type = request.solve_type;
-    globals->stats.total_iterations = 0;
 
     switch (globals->config.solve_type) {
         case HLP_SOLVE_TYPE_EXACT:
             globals->config.group = get_group64(request.mins);
+            globals->config.apply_and_check = apply_and_check_exact;
             break;
         case HLP_SOLVE_TYPE_PARTIAL:
             globals->config.group = get_min_group(request.mins, request.maxs);
+            globals->config.apply_and_check = apply_and_check_partial;
+            break;
+        case HLP_SOLVE_TYPE_RANGED:
+            globals->config.group = get_range_group(request.mins, request.maxs);
+            globals->config.apply_and_check = apply_and_check_ranged;
             break;
         default:
             printf("you found a search mode that isn't implemented\n");
@@ -370,26 +1697,136 @@ static int init(struct hlp_solve_globals* globals, struct hlp_request request) {
     globals->config.dont_care_count = _popcnt32(_mm_movemask_epi8(_mm256_castsi256_si128(globals->config.dont_care_mask)));
     globals->config.dont_care_post_sort_perm = _mm256_min_epi8(SHUFB_IDENTITY_256, _mm256_set1_epi8(15 - globals->config.dont_care_count));
 
+    _mm_storeu_si128((__m128i*) globals->config.finish_goal_min, _mm256_castsi256_si128(globals->config.goal_min));
+    _mm_storeu_si128((__m128i*) globals->config.finish_goal_max, _mm256_castsi256_si128(globals->config.goal_max));
+
+    // output x is in the top nibble of byte x for the first 8, and the
+    // bottom nibble of byte x - 8 for the rest
+    globals->config.projection = ~(uint64_t) 0;
+    for (int x = 0; x < 16; x++)
+        if (globals->config.finish_goal_min[x] == 0 && globals->config.finish_goal_max[x] == 15)
+            globals->config.projection &= ~((uint64_t) 15 << (x < 8 ? 8 * x + 4 : 8 * (x - 8)));
     return 0;
 }
 
+static int init(struct hlp_solve_globals* globals, struct hlp_request request) {
+    cache_init(&main_cache, global_thread_count);
+    // nothing proven for an earlier goal holds for this one
+    invalidate_cache(&main_cache);
+    globals->cache_stats = cache_stats_shard(&main_cache, 0);
+    globals->stats.start_time = clock();
+    globals->stats.total_iterations = 0;
+    globals->stats.leaf_batches = 0;
+    if (init_goal(globals, request)) return 1;
+
+    globals->config.engine = global_engine;
+    if (globals->config.engine == HLP_ENGINE_COMPACT && init_compact(globals))
+        globals->config.engine = HLP_ENGINE_DEPTH;
+
+    // every value the goal needs to have somewhere
+    uint16_t required_values = 0;
+    for (int x = 0; x < 16; x++)
+        if (globals->config.finish_goal_min[x] == globals->config.finish_goal_max[x])
+            required_values |= 1 << globals->config.finish_goal_min[x];
+
+    globals->config.finish_layers = 0;
+    globals->config.finish_index = NULL;
+    clock_t finish_start_time = clock();
+    // the compact engine never has the whole map to look up
+    int compact = globals->config.engine == HLP_ENGINE_COMPACT;
+    if (!compact && global_meet_layers && required_values) {
+        // the goal's half of the search, which covers everything the
+        // finish index would for this goal
+        globals->config.finish_index = hlp_finish_index_get_goal(globals->config.group, global_meet_layers, required_values);
+        if (globals->config.finish_index) globals->config.finish_layers = global_meet_layers;
+    } else if (!compact && global_finish_layers) {
+        globals->config.finish_index = hlp_finish_index_get(globals->config.group, global_finish_layers, global_finish_dir);
+        if (globals->config.finish_index) globals->config.finish_layers = global_finish_layers;
+    }
+    globals->config.beam_width = global_beam_width;
+    globals->config.macro_step = global_macro_step;
+    globals->config.use_pdb = global_use_pdb;
+    if (globals->config.use_pdb) {
+        clock_t pdb_start_time = clock();
+        if (hlp_pdb_init(&globals->config.pdb, globals->config.group, globals->config.finish_goal_min, globals->config.finish_goal_max))
+            globals->config.use_pdb = 0;
+        else if (verbosity >= 3)
+            printf("pattern databases ready after %.2fms\n", (double)(clock() - pdb_start_time) / CLOCKS_PER_SEC * 1000);
+    }
+
+    if (verbosity >= 3 && globals->config.finish_index) {
+        printf("finish index ready after %.2fms;", (double)(clock() - finish_start_time) / CLOCKS_PER_SEC * 1000);
+        for (int i = 0; i < globals->config.finish_layers; i++) printf(" %'ld", globals->config.finish_index->counts[i]);
+        printf(" maps\n");
+    }
+
+    return 0;
+}
+
+/* the fewest layers any solution could take, as one more than the lowest
+ * estimate out of every first layer
+ */
+static int get_start_estimate(struct hlp_solve_globals* globals, struct precomputed_hex_layer* base_layer, int max_depth) {
+    struct hlp_branch* branches = malloc(base_layer->next_layer_count * sizeof(struct hlp_branch));
+    int count = batch_apply_and_check_exact(globals, base_layer, base_layer->next_layer_luts, branches, IDENTITY_PERM_PK64, 0xff, 0xff);
+    int separations = 0xff;
+    for (int i = 0; i < count; i++)
+        if (branches[i].separations < separations) separations = branches[i].separations;
+    free(branches);
+    if (!count) return max_depth + 1;
+    return get_dist_estimate(ACCURACY_PERFECT, globals->config.group, separations) + 1;
+}
+
+// search everything up to the current depth once
+static int search_depth(struct hlp_solve_globals* globals, struct precomputed_hex_layer* base_layer) {
+    if (globals->config.engine == HLP_ENGINE_COMPACT) return compact_search_depth(globals);
+    if (globals->parallel.search && globals->config.current_bfs_depth >= PARALLEL_MIN_DEPTH)
+        return parallel_dfs(globals, base_layer);
+
+    // keep the serial search from splitting off tasks
+    struct hlp_parallel_search* search = globals->parallel.search;
+    globals->parallel.search = NULL;
+    reset_leaves(globals);
+    // one more depth for sort_branches_by_estimate to use as scratch
+    struct hlp_branch* staged_branches = malloc(base_layer->next_layer_count * (globals->config.current_bfs_depth + 1) * sizeof(struct hlp_branch));
+    int success = dfs(globals, IDENTITY_PERM_PK64, 0, get_root_path(globals), base_layer, staged_branches);
+    free(staged_branches);
+    globals->parallel.search = search;
+    return success;
+}
+
 //main search loop
 int single_search_inner(struct hlp_solve_globals* globals, struct precomputed_hex_layer* base_layer, int max_depth) {
-    globals->config.current_bfs_depth = 1;
+    // solve() already checked everything the finish index covers
+    globals->config.current_bfs_depth = globals->config.finish_layers + 1;
+
+    /* every child gets pruned once its length so far plus its estimate goes
+     * past the depth, so the depth already works as the bound on f = g + h.
+     * what's left for the engine is to skip the bounds the start is too far
+     * away for. past that, the last layer only knows its misses are at least
+     * one layer beyond, so the bound can't move up any faster than by one
+     */
+    if (globals->config.engine == HLP_ENGINE_IDA) {
+        int estimate = get_start_estimate(globals, base_layer, max_depth);
+        if (estimate > globals->config.current_bfs_depth) globals->config.current_bfs_depth = estimate;
+        if (verbosity >= 3) printf("starting at depth %d from the estimate\n", globals->config.current_bfs_depth);
+    }
 
     while (globals->config.current_bfs_depth <= max_depth) {
-        uint16_t* staged_branches = malloc(base_layer->next_layer_count * globals->config.current_bfs_depth * sizeof(uint16_t));
-        int success = dfs(globals, IDENTITY_PERM_PK64, 0, base_layer, staged_branches);
-        free(staged_branches);
+        int success = search_depth(globals, base_layer);
+        // current_bfs_depth is left at the depth that didn't get finished
+        if (globals->stats.timed_out) return max_depth + 1;
         if (success) {
+            if (globals->output.chain)
+                memcpy(globals->output.chain, globals->output.working_chain, globals->output.chain_length * sizeof(uint16_t));
             if (verbosity >= 3) {
                 printf("solution found at %.2fms\n", (double)(clock() - globals->stats.start_time) / CLOCKS_PER_SEC * 1000);
                 printf("total iter over all: %'ld\n", globals->stats.total_iterations);
+                printf("leaf batches: %'ld\n", globals->stats.leaf_batches);
                 cache_print_stats(&main_cache);
             }
             return globals->output.chain_length;
         }
-        invalidate_cache(&main_cache);
         globals->config.current_bfs_depth++;
 
         if (verbosity < 2) continue;
@@ -405,8 +1842,139 @@ int single_search_inner(struct hlp_solve_globals* globals, struct precomputed_he
     return max_depth + 1;
 }
 
+// how many outputs of the map aren't within the goal yet
+static int count_missed_outputs(struct hlp_solve_globals* globals, uint64_t map) {
+    __m128i xmm = unpack_uint_to_xmm(map);
+    __m128i missed = _mm_or_si128(
+            _mm_cmpgt_epi8(_mm256_castsi256_si128(globals->config.goal_min), xmm),
+            _mm_cmpgt_epi8(xmm, _mm256_castsi256_si128(globals->config.goal_max)));
+    return __builtin_popcount(_mm_movemask_epi8(missed));
+}
+
+static int cmp_beam_node(const void* a, const void* b) {
+    const struct hlp_beam_node* node_a = a;
+    const struct hlp_beam_node* node_b = b;
+    if (node_a->score != node_b->score) return node_a->score - node_b->score;
+    // same maps end up next to each other
+    return (node_a->hash > node_b->hash) - (node_a->hash < node_b->hash);
+}
+
+// write out the chain leading to a node in the beam at the given depth
+static void get_beam_chain(struct hlp_beam_node** beams, int depth, int index, uint16_t* chain) {
+    for (; depth > 0; depth--) {
+        struct hlp_beam_node* node = beams[depth] + index;
+        chain[depth - 1] = node->layer->config;
+        index = node->parent;
+    }
+}
+
+/* instead of searching everything, only keep the beam_width chains that look
+ * closest to the goal at each length, going by the distance check. nothing
+ * gets pruned, so this can go much deeper than the other engines, but there's
+ * no telling if it missed anything shorter
+ * returns the length of the chain found in working_chain, max_depth + 1 if
+ * there's none
+ */
+static int beam_search(struct hlp_solve_globals* globals, struct precomputed_hex_layer* base_layer, int max_depth) {
+    if (test_map(globals, IDENTITY_PERM_PK64)) return 0;
+
+    int width = globals->config.beam_width;
+    int layer_count = base_layer->next_layer_count;
+    struct hlp_beam_node* beams[32] = { 0 };
+    struct hlp_beam_node* candidates = malloc((size_t) width * layer_count * sizeof(struct hlp_beam_node));
+    struct hlp_branch* branches = malloc(layer_count * sizeof(struct hlp_branch));
+    beams[0] = malloc(sizeof(struct hlp_beam_node));
+    beams[0][0] = (struct hlp_beam_node) { IDENTITY_PERM_PK64, get_map_hash(globals, IDENTITY_PERM_PK64), base_layer, -1, 0 };
+    int beam_count = 1;
+    int result = max_depth + 1;
+
+    for (int depth = 0; depth < max_depth && result > max_depth; depth++) {
+        if (search_aborted(globals)) break;
+        int candidate_count = 0;
+        for (int i = 0; i < beam_count && result > max_depth; i++) {
+            struct hlp_beam_node* node = beams[depth] + i;
+
+            // the finish index might already know the way from here
+            if (globals->config.finish_layers) {
+                globals->config.current_bfs_depth = depth + globals->config.finish_layers;
+                if (globals->config.current_bfs_depth > max_depth) globals->config.current_bfs_depth = max_depth;
+                if (finish_search(globals, node->map, depth)) {
+                    get_beam_chain(beams, depth, i, globals->output.working_chain);
+                    result = globals->output.chain_length;
+                    break;
+                }
+            }
+
+            count_iterations(globals, depth + 1, node->layer->next_layer_count);
+            int count = batch_apply_and_check_exact(globals, node->layer, node->layer->next_layer_luts, branches, node->map, 0xff, 0xff);
+            for (int j = 0; j < count; j++) {
+                struct hlp_beam_node* candidate = candidates + candidate_count++;
+                candidate->map = branches[j].map;
+                candidate->hash = branches[j].hash;
+                candidate->layer = node->layer->next_layers[branches[j].index & BRANCH_INDEX_MASK];
+                candidate->parent = i;
+                candidate->score = (branches[j].separations << 8) | count_missed_outputs(globals, branches[j].map);
+                if (candidate->score & 0xff) continue;
+                get_beam_chain(beams, depth, i, globals->output.working_chain);
+                globals->output.working_chain[depth] = candidate->layer->config;
+                result = depth + 1;
+                break;
+            }
+        }
+        if (result <= max_depth || !candidate_count) break;
+
+        // keep the best of them, skipping any map that's already in
+        qsort(candidates, candidate_count, sizeof(struct hlp_beam_node), cmp_beam_node);
+        beams[depth + 1] = malloc(width * sizeof(struct hlp_beam_node));
+        beam_count = 0;
+        for (int i = 0; i < candidate_count && beam_count < width; i++) {
+            if (beam_count && beams[depth + 1][beam_count - 1].hash == candidates[i].hash) continue;
+            beams[depth + 1][beam_count++] = candidates[i];
+        }
+        if (verbosity >= 3) printf("beam at layer %d: %d chains, best score %d\n", depth + 1, beam_count, beams[depth + 1][0].score);
+    }
+
+    for (int depth = 0; depth < 32; depth++) free(beams[depth]);
+    free(candidates);
+    free(branches);
+    return result;
+}
+
+/* go through every chain of the given length that reaches the goal, once
+ * nothing shorter does. anything with a solution under it stays out of the
+ * cache, so every other way of getting to it gets searched too. what's already
+ * in the cache still holds, as it only ever has dead ends
+ */
+static long enumerate_solutions(struct hlp_solve_globals* globals, struct precomputed_hex_layer* base_layer, int length) {
+    // the finish index only knows one way to finish, and the presearch
+    // stopped at its first solution
+    globals->config.finish_layers = 0;
+    globals->config.covered_depth = 0;
+    globals->config.presearch_length = 0;
+    globals->config.current_bfs_depth = length;
+    globals->output.solutions_found = 0;
+    globals->output.print_solutions = global_solutions == HLP_SOLUTIONS_ALL;
+    globals->parallel.search = NULL;
+    reset_leaves(globals);
+    // the search for the first solution stopped partway through, so only
+    // what it proved below the root still holds
+    cache_carry_over(&main_cache, length - 1);
+
+    struct hlp_branch* staged_branches = malloc(base_layer->next_layer_count * (length + 1) * sizeof(struct hlp_branch));
+    dfs(globals, IDENTITY_PERM_PK64, 0, get_root_path(globals), base_layer, staged_branches);
+    free(staged_branches);
+
+    long count = globals->output.solutions_found;
+    globals->output.solutions_found = -1;
+    // the goal itself, reached by not doing anything
+    if (!length) count = 1;
+    printf("%'ld solutions of length %d\n", count, length);
+    return count;
+}
+
 int solve(struct hlp_request request, uint16_t* output_chain, int max_depth, enum search_accuracy accuracy) {
     struct hlp_solve_globals globals = {0};
+    double deadline = global_time_limit ? get_wall_time() + global_time_limit : 0;
     int requested_max_depth = max_depth;
     if (max_depth < 0 || max_depth > 31) max_depth = 31;
 
@@ -423,8 +1991,39 @@ int solve(struct hlp_request request, uint16_t* output_chain, int max_depth, enu
         return 1;
     }
 
+    // short enough to not need a search at all
+    if (globals.config.finish_layers) {
+        int length = hlp_finish_lookup(
+                globals.config.finish_index,
+                IDENTITY_PERM_PK64,
+                globals.config.finish_goal_min,
+                globals.config.finish_goal_max,
+                max_depth < globals.config.finish_layers ? max_depth : globals.config.finish_layers,
+                globals.output.working_chain);
+        if (length) {
+            if (output_chain) memcpy(output_chain, globals.output.working_chain, length * sizeof(uint16_t));
+            if (global_solutions != HLP_SOLUTIONS_FIRST) {
+                globals.config.accuracy = accuracy;
+                enumerate_solutions(&globals, identity_layer, length);
+            }
+            return length;
+        }
+        if (max_depth <= globals.config.finish_layers) return requested_max_depth + 1;
+    }
+
     globals.output.chain = output_chain;
     globals.output.solutions_found = -1;
+    globals.config.deadline = deadline;
+
+    if (globals.config.engine == HLP_ENGINE_BEAM) {
+        int length = beam_search(&globals, identity_layer, max_depth);
+        if (verbosity >= 2) printf("total iter across searches: %'ld\n", globals.stats.total_iterations);
+        if (length > max_depth) return requested_max_depth + 1;
+        if (output_chain) memcpy(output_chain, globals.output.working_chain, length * sizeof(uint16_t));
+        return length;
+    }
+    if (global_thread_count > 1)
+        globals.parallel.search = parallel_search_new(&globals, identity_layer, global_thread_count);
     int solution_length = max_depth;
 
     if (verbosity >= 2) {
@@ -440,19 +2039,344 @@ int solve(struct hlp_request request, uint16_t* output_chain, int max_depth, enu
     solution_length = single_search_inner(&globals, identity_layer, solution_length);
 
     if (solution_length == max_depth) solution_length = max_depth;
-    if (accuracy == ACCURACY_REDUCED) return solution_length;
+    if (globals.stats.timed_out) {
+        parallel_search_free(globals.parallel.search);
+        if (verbosity > 0) printf("time limit reached during layer %d\n", globals.config.current_bfs_depth);
+        return requested_max_depth + 1;
+    }
+    if (accuracy == ACCURACY_REDUCED) {
+        parallel_search_free(globals.parallel.search);
+        if (global_solutions != HLP_SOLUTIONS_FIRST && solution_length <= max_depth)
+            enumerate_solutions(&globals, identity_layer, solution_length);
+        return solution_length;
+    }
     long total_iter = globals.stats.total_iterations;
     globals.stats.total_iterations = 0;
 
     if (verbosity >= 2) printf("starting main search\n");
 
+    // the presearch proved every depth short of its solution, so the main
+    // search only needs to look at what the presearch pruned, starting from
+    // wherever it found its solution
+    globals.config.covered_depth = solution_length - 1;
+    globals.config.covered_accuracy = ACCURACY_REDUCED;
+    globals.config.covered_limit = get_carry_limit(&globals, ACCURACY_REDUCED, accuracy);
+    if (solution_length <= max_depth) {
+        globals.config.presearch_length = solution_length;
+        memcpy(globals.config.presearch_chain, globals.output.working_chain, solution_length * sizeof(uint16_t));
+    }
+
+    cache_carry_over(&main_cache, globals.config.covered_limit);
     globals.config.accuracy = accuracy;
     int result = single_search_inner(&globals, identity_layer, solution_length - 1);
+    parallel_search_free(globals.parallel.search);
     if (verbosity >= 2) printf("total iter across searches: %'ld\n", total_iter + globals.stats.total_iterations);
+    // whatever the presearch found is the best there is so far
+    if (globals.stats.timed_out) {
+        if (verbosity > 0) printf("time limit reached during layer %d\n", globals.config.current_bfs_depth);
+        if (verbosity > 0 && accuracy == ACCURACY_PERFECT)
+            printf("no chain shorter than %d layers\n", globals.config.current_bfs_depth);
+        return result > max_depth ? requested_max_depth + 1 : result;
+    }
     if (result > max_depth) return requested_max_depth + 1;
+    if (global_solutions != HLP_SOLUTIONS_FIRST) enumerate_solutions(&globals, identity_layer, result);
     return result;
 }
 
+/* prove that nothing shorter than the given length reaches the goal, with a
+ * single pass at one layer short of it. pruning is perfect, so this pass alone
+ * covers every shorter chain too, as each one comes up along the way and gets
+ * caught by the check every map goes through. writes out the chain if one
+ * turns up instead
+ * returns the length of that chain, or length if the bound holds
+ */
+static int certify(struct hlp_request request, uint16_t* output_chain, int length) {
+    struct hlp_solve_globals globals = {0};
+    if (init(&globals, request)) {
+        printf("an error occurred\n");
+        return length;
+    }
+    struct precomputed_hex_layer* identity_layer = precompute_hex_layers(globals.config.group, 1);
+
+    globals.config.accuracy = ACCURACY_PERFECT;
+    globals.config.current_bfs_depth = length - 1;
+    globals.output.chain = output_chain;
+    globals.output.solutions_found = -1;
+    if (global_thread_count > 1)
+        globals.parallel.search = parallel_search_new(&globals, identity_layer, global_thread_count);
+
+    int found = test_map(&globals, IDENTITY_PERM_PK64);
+    if (found) globals.output.chain_length = 0;
+    else if (length > 1) found = search_depth(&globals, identity_layer);
+    parallel_search_free(globals.parallel.search);
+
+    if (found) {
+        memcpy(output_chain, globals.output.working_chain, globals.output.chain_length * sizeof(uint16_t));
+        return globals.output.chain_length;
+    }
+
+    printf("certificate: no chain of %d layers or fewer\n", length - 1);
+    printf("group %d, perfect accuracy, %d finish layers%s\n",
+            globals.config.group,
+            globals.config.finish_layers,
+            globals.config.use_pdb ? ", pdb" : "");
+    for (int depth = 1; depth < length; depth++)
+        printf("depth %d: %'ld\n", depth, globals.stats.depth_iterations[depth]);
+    printf("total: %'ld\n", globals.stats.total_iterations);
+    return length;
+}
+
+// give a goal the chain that's being searched, up to the given length
+static void record_multi_solution(struct hlp_multi_search* search, int goal, int length) {
+    search->lengths[goal] = length;
+    memcpy(search->chains[goal], search->working_chain, length * sizeof(uint16_t));
+    search->unsolved_count--;
+}
+
+/* like dfs, but for every goal in the list at once. each entry is a goal
+ * times 2, plus 1 if the path so far is covered for it, the same as
+ * PATH_COVERED. a goal only gets passed down to the children that pass its
+ * distance check and that it isn't covered for.
+ * the cache is shared by paths with different goals left, so an entry only
+ * means none of the goals that were left on that path can be reached. it
+ * still holds for every goal that's left anywhere later on in the same pass:
+ * a goal that failed the distance check fails it for everything below too,
+ * the presearch already proved the covered ones can't be reached, and solved
+ * goals and ones past their limit stay that way for the rest of the pass.
+ * the next pass starts some of them over, so it needs a fresh cache
+ * returns 1 once there's nothing left to solve
+ */
+static int multi_dfs(struct hlp_multi_search* search, uint64_t input, int depth, struct precomputed_hex_layer* layer, struct hlp_branch* staged_branches, const int* goals, int goal_count) {
+    // goals solved since the list was made are skipped everywhere
+    int bfs_depth = search->current_bfs_depth;
+    for (int i = 0; i < goal_count; i++) {
+        int goal = goals[i] >> 1;
+        if (search->lengths[goal] > bfs_depth && test_map(search->goals + goal, input))
+            record_multi_solution(search, goal, depth);
+    }
+    if (!search->unsolved_count) return 1;
+
+    if (bfs_depth - depth <= search->finish_layers) {
+        for (int i = 0; i < goal_count; i++) {
+            int goal = goals[i] >> 1;
+            if (search->lengths[goal] <= bfs_depth) continue;
+            search->total_iterations++;
+            int length = hlp_finish_lookup(
+                    search->finish_index,
+                    input,
+                    search->goals[goal].config.finish_goal_min,
+                    search->goals[goal].config.finish_goal_max,
+                    bfs_depth - depth,
+                    search->working_chain + depth);
+            if (length) record_multi_solution(search, goal, depth + length);
+        }
+        return !search->unsolved_count;
+    }
+
+    if (depth == bfs_depth - 1) {
+        for (int i = 0; i < goal_count; i++) {
+            int goal = goals[i] >> 1;
+            if (search->lengths[goal] <= bfs_depth) continue;
+            search->total_iterations += layer->next_layer_count;
+            if (!fast_last_layer_search(search->goals + goal, input, layer, layer->next_layer_luts)) continue;
+            search->working_chain[depth] = search->goals[goal].output.working_chain[depth];
+            record_multi_solution(search, goal, depth + 1);
+        }
+        return !search->unsolved_count;
+    }
+
+    // which children pass for each goal in the list, and which of those
+    // don't pass the covered threshold, 2 bitmaps per goal
+    int remaining = bfs_depth - depth - 1;
+    int words = (layer->next_layer_count + 63) / 64;
+    struct hlp_branch* children = staged_branches + layer->next_layer_count;
+    uint64_t* passed = search->passed + (size_t) depth * search->goal_count * 2 * MULTI_BITMAP_WORDS;
+    uint64_t any_passed[MULTI_BITMAP_WORDS] = { 0 };
+    // the fewest separations any goal has left after each child
+    uint8_t estimates[HEX_CONFIG_COUNT];
+    memset(estimates, 16, layer->next_layer_count);
+    for (int i = 0; i < goal_count; i++) {
+        uint64_t* goal_passed = passed + 2 * i * MULTI_BITMAP_WORDS;
+        uint64_t* goal_extra = goal_passed + MULTI_BITMAP_WORDS;
+        memset(goal_passed, 0, 2 * MULTI_BITMAP_WORDS * sizeof(uint64_t));
+        struct hlp_solve_globals* goal = search->goals + (goals[i] >> 1);
+        if (search->lengths[goals[i] >> 1] <= bfs_depth) continue;
+
+        int threshold = get_dist_threshold(goal, remaining);
+        int covered_threshold = threshold;
+        if (goals[i] & 1)
+            covered_threshold = get_dist_threshold_at(goal->config.covered_accuracy, goal->config.group, remaining);
+        int count = batch_apply_and_check_exact(goal, layer, layer->next_layer_luts, staged_branches, input, threshold, covered_threshold);
+        search->total_iterations += layer->next_layer_count;
+        for (int j = 0; j < count; j++) {
+            int index = staged_branches[j].index & BRANCH_INDEX_MASK;
+            uint64_t bit = (uint64_t) 1 << (index % 64);
+            goal_passed[index / 64] |= bit;
+            if (staged_branches[j].index & BRANCH_EXTRA) goal_extra[index / 64] |= bit;
+            if (staged_branches[j].separations < estimates[index]) estimates[index] = staged_branches[j].separations;
+            children[index] = staged_branches[j];
+        }
+        for (int word = 0; word < words; word++) any_passed[word] |= goal_passed[word];
+    }
+
+    // same as sort_branches_by_estimate, the presearch goes through the
+    // children closest to a goal first, counting sorted by index
+    uint16_t order[HEX_CONFIG_COUNT];
+    int order_count = 0;
+    int presearch = search->goals[goals[0] >> 1].config.accuracy == ACCURACY_REDUCED;
+    int starts[17] = { 0 };
+    for (int index = 0; index < layer->next_layer_count; index++)
+        if (any_passed[index / 64] >> (index % 64) & 1) {
+            starts[presearch ? 16 - estimates[index] : 0]++;
+            order_count++;
+        }
+    for (int key = 1; key < 17; key++) starts[key] += starts[key - 1];
+    for (int index = layer->next_layer_count - 1; index >= 0; index--)
+        if (any_passed[index / 64] >> (index % 64) & 1) order[--starts[presearch ? 16 - estimates[index] : 0]] = index;
+
+    int* child_goals = search->goal_lists + (size_t) (depth + 1) * search->goal_count;
+    for (int rank = order_count - 1; rank >= 0; rank--) {
+        int index = order[rank];
+        uint64_t bit = (uint64_t) 1 << (index % 64);
+
+        // the presearch already went through covered children, so they're
+        // only worth going into for goals they aren't covered for
+        int child_count = 0;
+        for (int i = 0; i < goal_count; i++) {
+            uint64_t* goal_passed = passed + 2 * i * MULTI_BITMAP_WORDS;
+            if (!(goal_passed[index / 64] & bit)) continue;
+            int goal = goals[i] >> 1;
+            if (search->lengths[goal] <= bfs_depth) continue;
+            int covered = (goals[i] & 1) && !(goal_passed[MULTI_BITMAP_WORDS + index / 64] & bit);
+            if (covered && remaining <= search->goals[goal].config.covered_limit) continue;
+            child_goals[child_count++] = goal * 2 + covered;
+        }
+        if (!child_count) continue;
+
+        struct hlp_branch* branch = children + index;
+        if (cache_check_hashed(&main_cache, search->cache_stats, branch->hash, remaining)) continue;
+
+        struct precomputed_hex_layer* next_layer = layer->next_layers[index];
+        search->working_chain[depth] = next_layer->config;
+        if (multi_dfs(search, branch->map, depth + 1, next_layer, children + layer->next_layer_count, child_goals, child_count)) return 1;
+        cache_store_hashed(&main_cache, search->cache_stats, branch->hash, remaining);
+    }
+    return 0;
+}
+
+/* search every depth up to the limit of each unsolved goal, giving each one
+ * the first chain that turns up for it. covered goals start out covered,
+ * like a main search after a presearch
+ */
+static void multi_search_pass(struct hlp_multi_search* search, struct precomputed_hex_layer* base_layer, struct hlp_branch* staged_branches, const int* limits, int covered, int max_depth) {
+    for (int depth = 0; depth <= max_depth; depth++) {
+        // goals that already have something this short drop out
+        int goal_count = 0;
+        for (int goal = 0; goal < search->goal_count; goal++) {
+            if (limits[goal] < depth || search->lengths[goal] < depth) continue;
+            search->goals[goal].config.current_bfs_depth = depth;
+            search->goal_lists[goal_count++] = goal * 2 + covered;
+        }
+        search->unsolved_count = goal_count;
+        if (!goal_count) return;
+
+        search->current_bfs_depth = depth;
+        if (depth == 0) {
+            for (int i = 0; i < goal_count; i++)
+                if (test_map(search->goals + (search->goal_lists[i] >> 1), IDENTITY_PERM_PK64))
+                    record_multi_solution(search, search->goal_lists[i] >> 1, 0);
+            continue;
+        }
+        multi_dfs(search, IDENTITY_PERM_PK64, 0, base_layer, staged_branches, search->goal_lists, goal_count);
+        if (verbosity >= 2) printf("search over layer %d done, %d goals left\n", depth, search->unsolved_count);
+    }
+}
+
+int solve_multi(struct hlp_request* requests, int count, uint16_t (*chains)[32], int* lengths, int max_depth, enum search_accuracy accuracy) {
+    if (max_depth < 0 || max_depth > 31) max_depth = 31;
+    cache_init(&main_cache, 1);
+    // same as init, nothing proven for earlier goals holds for these
+    invalidate_cache(&main_cache);
+
+    struct hlp_multi_search search = {0};
+    search.goals = aligned_alloc(32, count * sizeof(struct hlp_solve_globals));
+    search.goal_count = count;
+    search.chains = chains;
+    search.lengths = lengths;
+    search.cache_stats = cache_stats_shard(&main_cache, 0);
+    int* limits = malloc(count * sizeof(int));
+
+    // the layers have to cover the goal with the fewest values
+    int group = 16;
+    for (int i = 0; i < count; i++) {
+        struct hlp_solve_globals* goal = search.goals + i;
+        memset(goal, 0, sizeof(struct hlp_solve_globals));
+        lengths[i] = max_depth + 1;
+        limits[i] = -1;
+        if (init_goal(goal, requests[i])) continue;
+        goal->output.solutions_found = -1;
+        // the cache is shared, so it has to tell apart maps that only
+        // differ where one of the goals doesn't care
+        goal->config.projection = ~(uint64_t) 0;
+        // same as in solve
+        if (requests[i].mins == 0) {
+            chains[i][0] = 0x2f0;
+            lengths[i] = 1;
+            continue;
+        }
+        if (goal->config.group < group) group = goal->config.group;
+        limits[i] = max_depth;
+    }
+
+    struct precomputed_hex_layer* identity_layer = precompute_hex_layers(group, 1);
+    struct hlp_branch* staged_branches = malloc(identity_layer->next_layer_count * 2 * (max_depth + 1) * sizeof(struct hlp_branch));
+    search.goal_lists = malloc((size_t) (max_depth + 1) * count * sizeof(int));
+    search.passed = malloc((size_t) (max_depth + 1) * count * 2 * MULTI_BITMAP_WORDS * sizeof(uint64_t));
+    // the goals don't share the values they need, so there's no meeting
+    // them partway, but the plain finish index works for all of them
+    int finish_layers = global_finish_layers ? global_finish_layers : global_meet_layers;
+    if (finish_layers > HLP_FINISH_MAX_LAYERS) finish_layers = HLP_FINISH_MAX_LAYERS;
+    if (finish_layers) search.finish_index = hlp_finish_index_get(group, finish_layers, global_finish_dir);
+    if (search.finish_index) search.finish_layers = finish_layers;
+
+    // same as solve, a reduced accuracy pass first gets every goal a chain
+    // quickly, and then the real one only has to look for shorter ones in
+    // what the first one pruned
+    for (int i = 0; i < count; i++) {
+        struct hlp_solve_globals* goal = search.goals + i;
+        if (limits[i] < 0) continue;
+        goal->config.accuracy = ACCURACY_REDUCED;
+        goal->config.finish_layers = search.finish_layers;
+        goal->config.covered_accuracy = ACCURACY_REDUCED;
+        goal->config.covered_limit = get_carry_limit(goal, ACCURACY_REDUCED, accuracy);
+    }
+    if (verbosity >= 2) printf("starting presearch\n");
+    multi_search_pass(&search, identity_layer, staged_branches, limits, 0, max_depth);
+
+    if (accuracy != ACCURACY_REDUCED) {
+        for (int i = 0; i < count; i++) {
+            if (limits[i] < 0) continue;
+            limits[i] = lengths[i] - 1;
+            search.goals[i].config.accuracy = accuracy;
+        }
+        // what the presearch stored after solving a goal says nothing
+        // about that goal, which is back to being searched for here
+        invalidate_cache(&main_cache);
+        if (verbosity >= 2) printf("starting main search\n");
+        multi_search_pass(&search, identity_layer, staged_branches, limits, 1, max_depth);
+    }
+    if (verbosity >= 2) printf("total iter across searches: %'ld\n", search.total_iterations);
+
+    free(staged_branches);
+    free(search.goals);
+    free(search.goal_lists);
+    free(search.passed);
+    free(limits);
+    int solved = 0;
+    for (int i = 0; i < count; i++) solved += lengths[i] <= max_depth;
+    return solved;
+}
+
 void print_hlp_map(uint64_t map) {
     struct hlp_request request = {map, map};
     print_hlp_request(request);
@@ -497,6 +2421,15 @@ void hlp_print_search(char* map) {
         printf("\n");
     }
 
+    if (global_certify_length) {
+        int length = certify(request, result, global_certify_length);
+        if (length == global_certify_length) return;
+        if (verbosity > 0) printf("not certified, result found, length %d:  ", length);
+        print_chain(result, length);
+        printf("\n");
+        return;
+    }
+
     int length = solve(request, result, global_max_depth, global_accuracy);
 
     if (length > global_max_depth) {
@@ -517,10 +2450,72 @@ void hlp_print_search(char* map) {
     }
 }
 
+void hlp_print_multi_search(char** maps, int count) {
+    struct hlp_request* requests = malloc(count * sizeof(struct hlp_request));
+    uint16_t (*chains)[32] = malloc(count * sizeof(*chains));
+    int* lengths = malloc(count * sizeof(int));
+    for (int i = 0; i < count; i++) {
+        // the same as if each one's spaces had split it up into arguments
+        char* map = malloc(strlen(maps[i]) + 1);
+        char* end = map;
+        for (char* c = maps[i]; *c; c++)
+            if (*c != ' ') *end++ = *c;
+        *end = 0;
+        requests[i] = parse_hlp_request_str(map);
+        free(map);
+        if (!requests[i].error) continue;
+        printf("Error: goal %d (%s) is malformed\n", i + 1, maps[i]);
+        free(requests);
+        free(chains);
+        free(lengths);
+        return;
+    }
+
+    solve_multi(requests, count, chains, lengths, global_max_depth, global_accuracy);
+
+    for (int i = 0; i < count; i++) {
+        if (verbosity > 0) {
+            printf("searching for ");
+            print_hlp_request(requests[i]);
+            printf("\n");
+        }
+        if (lengths[i] > global_max_depth) {
+            if (verbosity > 0) printf("no result found\n");
+            continue;
+        }
+        if (verbosity > 0) {
+            printf("result found, length %d", lengths[i]);
+            if (verbosity > 2 || requests[i].solve_type != HLP_SOLVE_TYPE_EXACT) {
+                printf(" (");
+                print_hlp_map(apply_hex_chain(IDENTITY_PERM_BE64, chains[i], lengths[i]));
+                printf(")");
+            }
+            printf(":  ");
+        }
+        print_chain(chains[i], lengths[i]);
+        printf("\n");
+    }
+    free(requests);
+    free(chains);
+    free(lengths);
+}
+
 enum LONG_OPTIONS {
     LONG_OPTION_MAX_DEPTH = 1000,
     LONG_OPTION_ACCURACY,
-    LONG_OPTION_CACHE_SIZE
+    LONG_OPTION_CACHE_SIZE,
+    LONG_OPTION_THREADS,
+    LONG_OPTION_FINISH_LAYERS,
+    LONG_OPTION_FINISH_DIR,
+    LONG_OPTION_MEET_LAYERS,
+    LONG_OPTION_PDB,
+    LONG_OPTION_ENGINE,
+    LONG_OPTION_MACRO_STEP,
+    LONG_OPTION_ALL_SOLUTIONS,
+    LONG_OPTION_COUNT_SOLUTIONS,
+    LONG_OPTION_CERTIFY,
+    LONG_OPTION_TIME_LIMIT,
+    LONG_OPTION_BEAM_WIDTH
 };
 
 static const struct argp_option options[] = {
@@ -528,7 +2523,19 @@ static const struct argp_option options[] = {
     { "perfect", 'p', 0, 0, "Equivilant to --accuracy 2" },
     { "max-layers", LONG_OPTION_MAX_DEPTH, "N", 0, "Limit results to chains up to N layers long" },
     { "accuracy", LONG_OPTION_ACCURACY, "LEVEL", 0, "Set search accuracy from -1 to 2, 0 being normal, 2 being perfect" },
-    { "cache", LONG_OPTION_CACHE_SIZE, "N", 0, "Set the cache size to 2**N bytes. default: 26 (64MB)" },
+    { "cache", LONG_OPTION_CACHE_SIZE, "N", 0, "Set the cache size to 2**N bytes, at least 19 (512KB). default: 26 (64MB)" },
+    { "time-limit", LONG_OPTION_TIME_LIMIT, "SECONDS", 0, "Stop searching after this long, keeping the best chain found so far" },
+    { "threads", LONG_OPTION_THREADS, "N", 0, "Split the search across N threads. default: 1" },
+    { "finish-layers", LONG_OPTION_FINISH_LAYERS, "N", 0, "Look up the last N layers in a precomputed index instead of searching them, up to 3, 0 to disable. default: 0" },
+    { "finish-dir", LONG_OPTION_FINISH_DIR, "DIR", 0, "Keep finish indexes as files in DIR, so they only get built once" },
+    { "meet-layers", LONG_OPTION_MEET_LAYERS, "N", 0, "Search the last N layers backwards from the goal ahead of time and meet the main search there, up to 7, for goals with exact outputs. default: 0" },
+    { "pdb", LONG_OPTION_PDB, 0, 0, "Also prune with pattern databases over each quarter of the goal, which take a few hundred ms to build" },
+    { "macro-step", LONG_OPTION_MACRO_STEP, 0, 0, "Search two layers per step, expanding grandchildren straight from precomputed pairs of layers" },
+    { "all-solutions", LONG_OPTION_ALL_SOLUTIONS, 0, 0, "Once the shortest length is found, print every chain of that length" },
+    { "count-solutions", LONG_OPTION_COUNT_SOLUTIONS, 0, 0, "Once the shortest length is found, count every chain of that length" },
+    { "certify", LONG_OPTION_CERTIFY, "L", 0, "Instead of searching, prove that no chain shorter than L layers exists with one perfect accuracy pass, printing how much was searched at each depth" },
+    { "engine", LONG_OPTION_ENGINE, "NAME", 0, "Search with compact (depth, but only on the outputs the goal cares about, for goals with up to 8 of them and depth otherwise), depth (plain iterative deepening), ida (IDA* on the distance estimate, closest children first) or beam (only the best chains at each length, not always optimal). default: depth" },
+    { "beam-width", LONG_OPTION_BEAM_WIDTH, "N", 0, "How many chains the beam engine keeps at each length. default: 1024" },
     { 0 }
 };
 
@@ -550,12 +2557,80 @@ static error_t parse_opt(int key, char* arg, struct argp_state *state) {
             global_max_depth = atoi(arg);
             break;
         case LONG_OPTION_CACHE_SIZE:
-            main_cache.size_log = (atoi(arg) - 4);
+            main_cache.size_log = atoi(arg);
+            break;
+        case LONG_OPTION_THREADS:
+            global_thread_count = atoi(arg);
+            if (global_thread_count < 1)
+                argp_error(state, "%s is not a valid thread count", arg);
+            break;
+        case LONG_OPTION_FINISH_LAYERS:
+            global_finish_layers = atoi(arg);
+            if (global_finish_layers < 0 || global_finish_layers > HLP_FINISH_MAX_LAYERS)
+                argp_error(state, "%s is not a valid number of finish layers", arg);
+            break;
+        case LONG_OPTION_FINISH_DIR:
+            global_finish_dir = arg;
+            break;
+        case LONG_OPTION_PDB:
+            global_use_pdb = 1;
+            break;
+        case LONG_OPTION_MACRO_STEP:
+            global_macro_step = 1;
+            break;
+        case LONG_OPTION_ALL_SOLUTIONS:
+            global_solutions = HLP_SOLUTIONS_ALL;
+            break;
+        case LONG_OPTION_COUNT_SOLUTIONS:
+            global_solutions = HLP_SOLUTIONS_COUNT;
+            break;
+        case LONG_OPTION_BEAM_WIDTH:
+            global_beam_width = atoi(arg);
+            if (global_beam_width < 1)
+                argp_error(state, "%s is not a valid beam width", arg);
+            break;
+        case LONG_OPTION_TIME_LIMIT:
+            global_time_limit = atof(arg);
+            if (global_time_limit <= 0)
+                argp_error(state, "%s is not a valid time limit", arg);
+            break;
+        case LONG_OPTION_CERTIFY:
+            global_certify_length = atoi(arg);
+            if (global_certify_length < 1 || global_certify_length > 32)
+                argp_error(state, "%s is not a valid length to certify", arg);
+            break;
+        case LONG_OPTION_ENGINE:
+            if (!strcmp(arg, "compact"))
+                global_engine = HLP_ENGINE_COMPACT;
+            else if (!strcmp(arg, "depth"))
+                global_engine = HLP_ENGINE_DEPTH;
+            else if (!strcmp(arg, "ida"))
+                global_engine = HLP_ENGINE_IDA;
+            else if (!strcmp(arg, "beam"))
+                global_engine = HLP_ENGINE_BEAM;
+            else
+                argp_error(state, "%s is not a valid engine", arg);
+            break;
+        case LONG_OPTION_MEET_LAYERS:
+            global_meet_layers = atoi(arg);
+            if (global_meet_layers < 0 || global_meet_layers > HLP_FINISH_MAX_CHAIN)
+                argp_error(state, "%s is not a valid number of meet layers", arg);
             break;
         case ARGP_KEY_INIT:
             global_accuracy = ACCURACY_NORMAL;
             global_max_depth = 31;
-            main_cache.size_log = 22;
+            global_thread_count = 1;
+            global_finish_layers = 0;
+            global_finish_dir = NULL;
+            global_meet_layers = 0;
+            global_use_pdb = 0;
+            global_engine = HLP_ENGINE_DEPTH;
+            global_macro_step = 0;
+            global_solutions = HLP_SOLUTIONS_FIRST;
+            global_certify_length = 0;
+            global_time_limit = 0;
+            global_beam_width = 1024;
+            main_cache.size_log = 26;
             settings->settings_redstone.global = settings->global;
             state->child_inputs[0] = &settings->settings_redstone;
             break;
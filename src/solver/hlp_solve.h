@@ -27,6 +27,14 @@ extern int hlp_solve_verbosity;
  */
 int solve(struct hlp_request request, uint16_t* output_chain, int max_depth, enum search_accuracy accuracy);
 
+/* search for a solution for every one of the given maps, going through the
+ * layers only once for all of them. each chain is as short as solve would
+ * have found for its map on its own. lengths are set past max_depth for any
+ * map without a solution
+ * returns how many got a solution
+ */
+int solve_multi(struct hlp_request* requests, int count, uint16_t (*chains)[32], int* lengths, int max_depth, enum search_accuracy accuracy);
+
 /* parse the string into a solve request
  */
 struct hlp_request parse_hlp_request_str(char* str);
@@ -42,6 +50,8 @@ uint16_t get_next_valid_layer_size(int group, int layer_id);
 
 void hlp_print_search(char* map);
 
+void hlp_print_multi_search(char** maps, int count);
+
 
 uint64_t apply_chain(uint64_t start, uint16_t* chain, int length);
 
@@ -158,6 +158,84 @@ static __m256i quad_pack_map256(ymm_pair_t unpacked) {
             );
 }
 
+/* the lanes left for the maps from index on, when there are count of them.
+ * map arrays are padded out with zeros, which can still pass some checks
+ */
+static inline int quad_valid_lanes(int index, int count) {
+    return count - index >= 4 ? 15 : (1 << (count - index)) - 1;
+}
+
+#ifdef USE_AVX512
+#if !defined(__AVX512BW__) || !defined(__AVX512VL__) || !defined(__AVX512VBMI__)
+#error "the avx512 build needs avx512bw, avx512vl and avx512vbmi enabled"
+#endif
+
+/* the avx512 versions of the map kernels work on 8 maps at a time. these
+ * follow the layout of the quad ones: unpacked maps get a 128 bit lane each,
+ * so everything in lane stays the same, just over 4 lanes
+ */
+typedef struct zmm_pair_s {
+    __m512i zmm0;
+    __m512i zmm1;
+} zmm_pair_t;
+
+#define QUAD_XMM(x)             _mm512_broadcast_i32x4(x)
+
+/* the vpermb and vpmultishiftqb controls for applying maps to an input, see
+ * octa_apply_map512. made once per input
+ */
+typedef struct octa_input_s {
+    __m512i perm;
+    __m512i shifts;
+} octa_input_t;
+
+static inline octa_input_t octa_prepare_input512(uint64_t input) {
+    __m512i values = QUAD_XMM(unpack_uint_to_xmm(input));
+    // value v is in byte v & 7 of a packed64 map, in the top nibble below 8
+    const __m512i lane_maps = _mm512_set_epi64(
+            BROADCAST_8x(8, 24), BROADCAST_8x(8, 24), BROADCAST_8x(8, 16), BROADCAST_8x(8, 16),
+            BROADCAST_8x(8, 8), BROADCAST_8x(8, 8), 0, 0);
+    const __m512i byte_offsets = _mm512_set1_epi64(0x3830282018100800);
+    __mmask64 high_nibbles = _mm512_cmplt_epu8_mask(values, _mm512_set1_epi8(8));
+    return (octa_input_t) {
+        _mm512_add_epi8(_mm512_and_si512(values, _mm512_set1_epi8(7)), lane_maps),
+        _mm512_mask_add_epi8(byte_offsets, high_nibbles, byte_offsets, _mm512_set1_epi8(4))
+    };
+}
+
+/* apply 8 packed64 maps to the input, giving one unpacked map per lane,
+ * maps 0-3 in zmm0 and 4-7 in zmm1. vpermb picks the byte each value is in,
+ * and vpmultishiftqb the nibble in it
+ */
+static inline zmm_pair_t octa_apply_map512(__m512i packed, octa_input_t input) {
+    const __m512i nibble_mask = _mm512_set1_epi8(15);
+    __m512i perm1 = _mm512_add_epi8(input.perm, _mm512_set1_epi8(32));
+    return (zmm_pair_t) {
+        _mm512_and_si512(_mm512_multishift_epi64_epi8(input.shifts, _mm512_permutexvar_epi8(input.perm, packed)), nibble_mask),
+        _mm512_and_si512(_mm512_multishift_epi64_epi8(input.shifts, _mm512_permutexvar_epi8(perm1, packed)), nibble_mask)
+    };
+}
+
+// the maps from octa_apply_map512 as packed64 maps again, in order
+static inline __m512i octa_pack_map512(zmm_pair_t unpacked) {
+    __m512i packed0 = _mm512_or_si512(_mm512_slli_epi64(unpacked.zmm0, 4), _mm512_bsrli_epi128(unpacked.zmm0, 8));
+    __m512i packed1 = _mm512_or_si512(_mm512_slli_epi64(unpacked.zmm1, 4), _mm512_bsrli_epi128(unpacked.zmm1, 8));
+    return _mm512_permutex2var_epi64(packed0, _mm512_set_epi64(14, 12, 10, 8, 6, 4, 2, 0), packed1);
+}
+
+/* bit k set for each 16 bit part of the masks that's all zeros, which is
+ * each lane of a zmm pair with nothing set, in the order of the maps
+ */
+static inline int octa_empty_lanes(__mmask64 mask0, __mmask64 mask1) {
+    return _mm_cmpeq_epi16_mask(_mm_set_epi64x(mask1, mask0), _mm_setzero_si128());
+}
+
+// the lanes left for the maps from index on, when there are count of them
+static inline int octa_valid_lanes(int index, int count) {
+    return count - index >= 8 ? 0xff : (1 << (count - index)) - 1;
+}
+#endif
+
 static uint64_t apply_mapping_packed64(uint64_t first, uint64_t second) {
     return pack_xmm_to_uint(_mm_shuffle_epi8(unpack_uint_to_xmm(second), unpack_uint_to_xmm(first)));
 }
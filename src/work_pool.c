@@ -0,0 +1,206 @@
+#include "work_pool.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEQUE_START_CAPACITY 64
+
+// each deque gets its own cache line(s) so workers don't fight over the locks
+struct work_deque {
+    pthread_mutex_t lock;
+    char* tasks;
+    long capacity;
+    // top is where thieves take from, bottom is where the owner works
+    long top, bottom;
+} __attribute__((aligned(64)));
+
+struct work_pool {
+    int thread_count;
+    size_t task_size;
+    work_pool_task_fn run_task;
+    void* context;
+    struct work_deque* deques;
+    // tasks pushed but not yet finished, including ones currently running
+    atomic_long pending;
+    atomic_int hungry;
+    atomic_int cancelled;
+};
+
+struct worker_arg {
+    struct work_pool* pool;
+    int id;
+};
+
+struct work_pool* work_pool_new(int thread_count, size_t task_size, work_pool_task_fn run_task, void* context) {
+    if (thread_count < 1) thread_count = 1;
+    struct work_pool* pool = malloc(sizeof(struct work_pool));
+    if (!pool) return NULL;
+    pool->deques = aligned_alloc(64, thread_count * sizeof(struct work_deque));
+    if (!pool->deques) {
+        free(pool);
+        return NULL;
+    }
+    pool->thread_count = thread_count;
+    pool->task_size = task_size;
+    pool->run_task = run_task;
+    pool->context = context;
+    atomic_init(&pool->pending, 0);
+    atomic_init(&pool->hungry, 0);
+    atomic_init(&pool->cancelled, 0);
+
+    for (int i = 0; i < thread_count; i++) {
+        struct work_deque* deque = pool->deques + i;
+        pthread_mutex_init(&deque->lock, NULL);
+        deque->capacity = DEQUE_START_CAPACITY;
+        deque->tasks = malloc(deque->capacity * task_size);
+        deque->top = 0;
+        deque->bottom = 0;
+    }
+    return pool;
+}
+
+void work_pool_free(struct work_pool* pool) {
+    if (!pool) return;
+    for (int i = 0; i < pool->thread_count; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+    free(pool->deques);
+    free(pool);
+}
+
+static char* deque_slot(struct work_pool* pool, struct work_deque* deque, long index) {
+    return deque->tasks + (index % deque->capacity) * pool->task_size;
+}
+
+void work_pool_push(struct work_pool* pool, int worker_id, void* task) {
+    struct work_deque* deque = pool->deques + worker_id;
+    atomic_fetch_add_explicit(&pool->pending, 1, memory_order_relaxed);
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom - deque->top == deque->capacity) {
+        // full, linearize into a bigger buffer
+        char* tasks = malloc(deque->capacity * 2 * pool->task_size);
+        for (long i = deque->top; i < deque->bottom; i++)
+            memcpy(tasks + (i - deque->top) * pool->task_size, deque_slot(pool, deque, i), pool->task_size);
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->bottom -= deque->top;
+        deque->top = 0;
+        deque->capacity *= 2;
+    }
+    memcpy(deque_slot(pool, deque, deque->bottom), task, pool->task_size);
+    deque->bottom++;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+static int deque_pop(struct work_pool* pool, struct work_deque* deque, void* task) {
+    int found = 0;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom > deque->top) {
+        deque->bottom--;
+        memcpy(task, deque_slot(pool, deque, deque->bottom), pool->task_size);
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static int deque_steal(struct work_pool* pool, struct work_deque* deque, void* task) {
+    // cheap unlocked peek first, most victims are empty when everyone is hungry
+    if (__atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) <= __atomic_load_n(&deque->top, __ATOMIC_RELAXED))
+        return 0;
+    int found = 0;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom > deque->top) {
+        memcpy(task, deque_slot(pool, deque, deque->top), pool->task_size);
+        deque->top++;
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static int find_task(struct work_pool* pool, int id, uint32_t* rng, void* task) {
+    if (deque_pop(pool, pool->deques + id, task)) return 1;
+    // xorshift, only used to spread the thieves out
+    *rng ^= *rng << 13;
+    *rng ^= *rng >> 17;
+    *rng ^= *rng << 5;
+    int start = *rng % pool->thread_count;
+    for (int i = 0; i < pool->thread_count; i++) {
+        int victim = (start + i) % pool->thread_count;
+        if (victim == id) continue;
+        if (deque_steal(pool, pool->deques + victim, task)) return 1;
+    }
+    return 0;
+}
+
+static void* worker_main(void* arg) {
+    struct work_pool* pool = ((struct worker_arg*) arg)->pool;
+    int id = ((struct worker_arg*) arg)->id;
+    char* task = malloc(pool->task_size);
+    uint32_t rng = 0x9e3779b9 * (id + 1);
+    int hungry = 0;
+
+    while (!work_pool_cancelled(pool)) {
+        if (find_task(pool, id, &rng, task)) {
+            if (hungry) atomic_fetch_sub_explicit(&pool->hungry, 1, memory_order_relaxed);
+            hungry = 0;
+            pool->run_task(task, id, pool->context);
+            atomic_fetch_sub_explicit(&pool->pending, 1, memory_order_acq_rel);
+            continue;
+        }
+        if (!hungry) atomic_fetch_add_explicit(&pool->hungry, 1, memory_order_relaxed);
+        hungry = 1;
+        if (atomic_load_explicit(&pool->pending, memory_order_acquire) == 0) break;
+        sched_yield();
+    }
+
+    if (hungry) atomic_fetch_sub_explicit(&pool->hungry, 1, memory_order_relaxed);
+    free(task);
+    return NULL;
+}
+
+void work_pool_run(struct work_pool* pool) {
+    pthread_t* threads = malloc(pool->thread_count * sizeof(pthread_t));
+    struct worker_arg* args = malloc(pool->thread_count * sizeof(struct worker_arg));
+    for (int i = 0; i < pool->thread_count; i++)
+        args[i] = (struct worker_arg) { pool, i };
+
+    // if a thread can't be made, its deque still gets drained by thieves
+    int* started = calloc(pool->thread_count, sizeof(int));
+    for (int i = 1; i < pool->thread_count; i++)
+        started[i] = !pthread_create(threads + i, NULL, worker_main, args + i);
+    worker_main(args);
+    for (int i = 1; i < pool->thread_count; i++)
+        if (started[i]) pthread_join(threads[i], NULL);
+
+    if (work_pool_cancelled(pool)) {
+        // drop anything left behind so the pool can be freed or rerun cleanly
+        for (int i = 0; i < pool->thread_count; i++)
+            pool->deques[i].top = pool->deques[i].bottom = 0;
+        atomic_store(&pool->pending, 0);
+    }
+    free(started);
+    free(args);
+    free(threads);
+}
+
+int work_pool_hungry(struct work_pool* pool) {
+    return atomic_load_explicit(&pool->hungry, memory_order_relaxed) > 0;
+}
+
+void work_pool_cancel(struct work_pool* pool) {
+    atomic_store_explicit(&pool->cancelled, 1, memory_order_release);
+}
+
+int work_pool_cancelled(struct work_pool* pool) {
+    return atomic_load_explicit(&pool->cancelled, memory_order_relaxed);
+}
+
+int work_pool_thread_count(struct work_pool* pool) {
+    return pool->thread_count;
+}
@@ -0,0 +1,49 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+#include <stddef.h>
+
+/* work stealing thread pool
+ *
+ * every worker owns a deque of fixed size tasks. workers push and pop from the
+ * bottom of their own deque, and when it runs dry they steal from the top of
+ * another worker's deque, which is where the oldest (and usually biggest)
+ * tasks end up. tasks are copied in by value, so they can live on the stack of
+ * whoever pushes them.
+ */
+struct work_pool;
+
+// called for every task, worker_id is in [0, thread_count)
+typedef void (*work_pool_task_fn)(void* task, int worker_id, void* context);
+
+/* create a pool, threads are not started until work_pool_run
+ * returns NULL on allocation failure
+ */
+struct work_pool* work_pool_new(int thread_count, size_t task_size, work_pool_task_fn run_task, void* context);
+
+void work_pool_free(struct work_pool* pool);
+
+/* push a task onto the deque of the given worker
+ * before work_pool_run is called this can be used to seed the pool
+ */
+void work_pool_push(struct work_pool* pool, int worker_id, void* task);
+
+/* run until every task, including any pushed while running, is done or the
+ * pool is cancelled. the calling thread acts as worker 0. can be called again
+ * after it returns to run another batch of tasks.
+ */
+void work_pool_run(struct work_pool* pool);
+
+/* nonzero if some worker is currently out of work, meaning it is worth
+ * splitting off more tasks instead of doing them directly
+ */
+int work_pool_hungry(struct work_pool* pool);
+
+/* stop handing out tasks, any queued tasks are dropped. tasks that are already
+ * running should check work_pool_cancelled and bail out on their own
+ */
+void work_pool_cancel(struct work_pool* pool);
+int work_pool_cancelled(struct work_pool* pool);
+
+int work_pool_thread_count(struct work_pool* pool);
+
+#endif
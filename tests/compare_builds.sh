@@ -0,0 +1,51 @@
+#!/bin/sh
+# run the same goals through two builds, like the regular one and one from
+# ./configure --enable-avx512, and check that they find the same lengths and
+# solution counts. how long each build took in total is printed at the end.
+# usage: tests/compare_builds.sh ./hlpt ../avx512/hlpt
+if [ $# -ne 2 ]; then
+    echo "usage: $0 HLPT OTHER_HLPT"
+    exit 2
+fi
+first=$1
+second=$2
+
+status=0
+time_first=0
+time_second=0
+
+now() {
+    date +%s.%N
+}
+
+# run one goal through both builds. chains can differ, so only the lengths
+# and counts have to match
+compare() {
+    start=$(now)
+    a=$("$first" "$@" | grep -o "found, length [0-9]*\|no result\|[0-9]* solutions of length [0-9]*")
+    middle=$(now)
+    b=$("$second" "$@" | grep -o "found, length [0-9]*\|no result\|[0-9]* solutions of length [0-9]*")
+    end=$(now)
+    time_first=$(echo "$time_first $start $middle" | awk '{ print $1 + $3 - $2 }')
+    time_second=$(echo "$time_second $middle $end" | awk '{ print $1 + $3 - $2 }')
+    if [ -z "$a" ] || [ "$a" != "$b" ]; then
+        echo "$*: '$(echo $a)' with $first, '$(echo $b)' with $second"
+        status=1
+    fi
+}
+
+# exact, partial and ranged goals, every solution of each
+compare hex -p --count-solutions 31415926
+compare hex -p --count-solutions 3.1.4.1.5.9
+compare hex -p --count-solutions 0-2f0-2f5-77a-c3
+# longer searches, which are most of the time in practice
+compare hex 0111222223333333
+compare hex 02468ace02468ace
+compare search-hlp-random -n 20 --seed 1
+compare search-hlp-random -n 20 --seed 2 --unique-values 6
+compare 2bin 0110100110010110
+compare 2bin 01101001 10010110 -t
+
+echo "$first: ${time_first}s"
+echo "$second: ${time_second}s"
+exit $status
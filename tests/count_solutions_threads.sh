@@ -0,0 +1,14 @@
+#!/bin/sh
+# the number of solutions can't depend on how many threads found the first one
+HLPT=${HLPT:-./hlpt}
+
+status=0
+for goal in 31415926 0111222223333333 3.1.4.1.5.9; do
+    single=$($HLPT hex -p --count-solutions --threads 1 $goal | grep "solutions of length")
+    multi=$($HLPT hex -p --count-solutions --threads 8 $goal | grep "solutions of length")
+    if [ -z "$single" ] || [ "$single" != "$multi" ]; then
+        echo "$goal: '$single' with 1 thread, '$multi' with 8"
+        status=1
+    fi
+done
+exit $status
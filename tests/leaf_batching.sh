@@ -0,0 +1,23 @@
+#!/bin/sh
+# by default the last layer gets searched in batches across siblings, and it
+# has to find the same length as searching it one parent at a time, which is
+# what happens with the finish index
+HLPT=${HLPT:-./hlpt}
+
+status=0
+for goal in 31415926 0111222223333333 3.1.4.1.5.9; do
+    batched=$($HLPT -v3 hex $goal)
+    unbatched=$($HLPT hex --finish-layers 1 $goal)
+    batches=$(echo "$batched" | grep "leaf batches" | tail -n 1 | sed 's/[^0-9]//g')
+    length=$(echo "$batched" | grep -o "result found, length [0-9]*")
+    expected=$(echo "$unbatched" | grep -o "result found, length [0-9]*")
+    if [ -z "$batches" ] || [ "$batches" -eq 0 ]; then
+        echo "$goal: the last layer never got batched"
+        status=1
+    fi
+    if [ -z "$length" ] || [ "$length" != "$expected" ]; then
+        echo "$goal: '$length' batched, '$expected' without"
+        status=1
+    fi
+done
+exit $status